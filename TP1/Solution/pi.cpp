@@ -1,5 +1,6 @@
+# include <algorithm>
 # include <chrono>
-# include <random>
+# include <cstdint>
 # include <iostream>
 # include <cstdio>
 # include <fstream>
@@ -8,31 +9,39 @@
 # include <string>
 # include <iomanip>
 # include <mpi.h>
+# include "../../TP3/Solution/Philox.hpp"
 
 
 // Attention , ne marche qu'en C++ 11 ou supérieur :
-double approximate_pi ( unsigned long nbSamples, int nb_samples_total, int rank, int size, const MPI_Comm& glob ) {
+// Les fléchettes sont numérotées globalement : la fléchette n prend ses
+// coordonnées dans le bloc n du générateur à compteur Philox (deux doubles
+// par bloc), tirés par lots. Ce processus lance les fléchettes first à
+// first + nbSamples - 1 : le résultat ne dépend que de la graine, pas du
+// nombre de processus.
+double approximate_pi ( unsigned long first, unsigned long nbSamples, unsigned long nb_samples_total,
+                        std::uint64_t seed, int rank, int size, const MPI_Comm& glob ) {
 
-    typedef std::chrono::high_resolution_clock myclock;
-    myclock::time_point beginning = myclock::now ();    
-    myclock :: duration d = myclock :: now()-beginning;
-    unsigned seed = rank+d.count();
-    std::default_random_engine generator(seed);
-    std::uniform_real_distribution<double> distribution ( -1.0 ,1.0);
+    const Philox4x32 philox(seed);
+    const std::size_t batchSize = 1024;
+    double uniforms[2*batchSize];
     unsigned long nbDarts = 0;
     // Throw nbSamples darts in the unit square [ -1:1] x [ -1:1]
-    for ( unsigned sample = 0; sample < nbSamples ; ++sample ) {
-        double x = distribution ( generator );
-        double y = distribution ( generator );
-        // Test if the dart is in the unit disk
-        if ( x*x+y*y <=1 ) nbDarts ++;
+    for ( unsigned long sample = 0; sample < nbSamples ; sample += batchSize ) {
+        std::size_t nb = std::min<unsigned long>(batchSize, nbSamples - sample);
+        philox.uniformDoubles( first + sample, 0, nb, uniforms );
+        for ( std::size_t k = 0; k < nb; ++k ) {
+            double x = 2.*uniforms[2*k]-1.;
+            double y = 2.*uniforms[2*k+1]-1.;
+            // Test if the dart is in the unit disk
+            if ( x*x+y*y <=1 ) nbDarts ++;
+        }
     }
     // Récuper le nombre total de nbDarts qu'on a obtenu sur tous les processeurs sur le proc zéro qui aura seul la solution
     if (rank == 0)
 	    for ( int p = 1; p < size; ++p)
 	    {
 		    MPI_Status status;
-		    int nb_darts;
+		    unsigned long nb_darts;
 		    MPI_Recv(&nb_darts, 1, MPI_UNSIGNED_LONG, p, 101, glob, &status);
 		    //std::cout << "recu de " << p << " sont nombre de flechettes" << std::flush << std::endl;
 		    nbDarts += nb_darts;
@@ -77,12 +86,20 @@ int main( int nargs, char* argv[] )
         fileName << "Output" << std::setfill('0') << std::setw(5) << rank << ".txt";
         std::ofstream output( fileName.str().c_str() );
 
-        int nbSamples = 1000;
-	if (nargs > 1) nbSamples = std::stoi(argv[1]);
-	int nbSamples_local = nbSamples/nbp;
-	if (rank < nbSamples%nbp) nbSamples_local += 1;
+        unsigned long nbSamples = 1000;
+	if (nargs > 1) nbSamples = std::stoul(argv[1]);
+	unsigned long nbSamples_local = nbSamples/nbp;
+	if (unsigned(rank) < nbSamples%nbp) nbSamples_local += 1;
+	unsigned long first = rank*(nbSamples/nbp) + std::min<unsigned long>(rank, nbSamples%nbp);
+	// Graine en deuxième argument pour reproduire un calcul ; sinon tirée
+	// de l'horloge par le processus 0 et diffusée (tous les processus
+	// doivent avoir la même)
+	std::uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+	if (nargs > 2) seed = std::stoull(argv[2]);
+	MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, globComm);
 
-        double r = approximate_pi(nbSamples_local, nbSamples, rank, nbp, globComm);
+        double r = approximate_pi(first, nbSamples_local, nbSamples, seed, rank, nbp, globComm);
+	output << "graine = " << seed << std::endl;
 	output << "pi = " << std::setprecision(10) << 4*r << std::endl;
 
         output.close();
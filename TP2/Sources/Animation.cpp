@@ -0,0 +1,189 @@
+# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <fstream>
+# include <functional>
+# include <iostream>
+# include <memory>
+# include <thread>
+# include <vector>
+# include "MandelbrotKernel.hpp"
+# include "Animation.hpp"
+# include "Palette.hpp"
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    double secondsSince( const Clock::time_point& start )
+    {
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        return elapsed.count();
+    }
+
+    /* Grille de pixels d'une vue : le pixel (W/2, H/2) est au centre */
+    struct FrameView
+    {
+        double xc, yc, spacing;
+        int W, H;
+        double re( int col ) const { return xc + (col - W/2)*spacing; }
+        double im( int row ) const { return yc + (row - H/2)*spacing; }
+    };
+
+    struct Frame
+    {
+        int index;
+        std::shared_ptr<const std::vector<int>> iters; // Ligne i rangée en W*(H-i-1)
+        std::vector<unsigned char> rgb;
+    };
+
+    FrameView frameView( const AnimationParameters& params, int k )
+    {
+        double zoom = params.zoom*std::pow(params.factor, k);
+        return FrameView{ params.centerRe, params.centerIm, 3./(zoom*params.W),
+                          params.W, params.H };
+    }
+
+    /* Indice du pixel de prev ayant exactement la coordonnée x (selon la
+     * grille 1D d'origine c0 et de pas spacing), ou -1 */
+    int coincidentIndex( double x, double c0, double spacing, int n )
+    {
+        double u = std::round((x - c0)/spacing) + n/2;
+        if ( (u < 0) || (u >= n) ) return -1;
+        int k = int(u);
+        return ( c0 + (k - n/2)*spacing == x ? k : -1 );
+    }
+
+    /* Étage 1 : nombres d'itérations de la vue, en reprenant ceux des
+     * pixels qui coïncident avec la vue précédente si prev n'est pas nul */
+    std::shared_ptr<const std::vector<int>>
+    computeFrame( const FrameView& view, int maxIter, const FrameView* prevView,
+                  const std::vector<int>* prev, long& nbReused )
+    {
+        const int W = view.W, H = view.H;
+        std::shared_ptr<std::vector<int>> iters = std::make_shared<std::vector<int>>(W*H);
+        long reused = 0;
+#       pragma omp parallel for schedule(dynamic) reduction(+:reused)
+        for ( int i = 0; i < H; ++i ) {
+            int* row = iters->data() + W*(H-i-1);
+            double ci = view.im(i);
+            int pi = ( prev ? coincidentIndex(ci, prevView->yc, prevView->spacing, H) : -1 );
+            std::vector<double> cre, cim;
+            std::vector<int> cols;
+            cre.reserve(W); cim.reserve(W); cols.reserve(W);
+            for ( int j = 0; j < W; ++j ) {
+                double cr = view.re(j);
+                if ( pi >= 0 ) {
+                    int pj = coincidentIndex(cr, prevView->xc, prevView->spacing, W);
+                    if ( pj >= 0 ) {
+                        row[j] = (*prev)[W*(H-pi-1)+pj];
+                        reused += 1;
+                        continue;
+                    }
+                }
+                cols.push_back(j);
+                cre.push_back(cr);
+                cim.push_back(ci);
+            }
+            std::vector<int> res(cols.size());
+            iterMandelbrotPoints(maxIter, int(cols.size()), cre.data(), cim.data(), res.data());
+            for ( std::size_t k = 0; k < cols.size(); ++k ) row[cols[k]] = res[k];
+        }
+        nbReused += reused;
+        return iters;
+    }
+
+    /* Étage 2 : mise en couleurs (Palette.hpp) */
+    void colourFrame( Frame& frame, int maxIter )
+    {
+        const std::vector<int>& iters = *frame.iters;
+        double scaleCol = 1./maxIter;
+        frame.rgb.resize(3*iters.size());
+        for ( std::size_t i = 0; i < iters.size(); ++i )
+            iterToColour(scaleCol, iters[i], frame.rgb.data() + 3*i);
+    }
+
+    /* Étage 3 : écriture du fichier PPM */
+    void writeFrame( const Frame& frame, const AnimationParameters& params )
+    {
+        char filename[1024];
+        std::snprintf(filename, sizeof(filename), "%s_%04d.ppm", params.prefix.c_str(), frame.index);
+        std::ofstream ofs( filename, std::ios::out | std::ios::binary );
+        ofs << "P6\n" << params.W << " " << params.H << "\n255\n";
+        ofs.write(reinterpret_cast<const char*>(frame.rgb.data()), frame.rgb.size());
+    }
+}
+// =====================================================================
+void
+renderZoomAnimation( const AnimationParameters& params )
+{
+    // Temps passé à travailler par chaque étage (hors attente dans les files)
+    double busy[3] = { 0., 0., 0. };
+    long nbReused = 0;
+    Clock::time_point start = Clock::now();
+
+    std::shared_ptr<const std::vector<int>> prev;
+    FrameView prevView{0., 0., 0., 0, 0};
+    // Étage 1, exécuté par le thread appelant ; output reçoit chaque image
+    auto computeStage = [&] ( const std::function<void(Frame&&)>& output ) {
+        for ( int k = 0; k < params.nbFrames; ++k ) {
+            Clock::time_point t0 = Clock::now();
+            FrameView view = frameView(params, k);
+            Frame frame;
+            frame.index = k;
+            bool reuse = params.reuse && prev;
+            frame.iters = computeFrame(view, params.maxIter, ( reuse ? &prevView : nullptr ),
+                                       ( reuse ? prev.get() : nullptr ), nbReused);
+            prev = frame.iters;
+            prevView = view;
+            busy[0] += secondsSince(t0);
+            output(std::move(frame));
+        }
+    };
+
+    if ( params.pipelined ) {
+        BoundedQueue<Frame> toColour(2), toWrite(2);
+        std::thread colourer([&] () {
+            Frame frame;
+            while ( toColour.pop(frame) ) {
+                Clock::time_point t0 = Clock::now();
+                colourFrame(frame, params.maxIter);
+                frame.iters.reset();
+                busy[1] += secondsSince(t0);
+                toWrite.push(std::move(frame));
+            }
+            toWrite.close();
+        });
+        std::thread writer([&] () {
+            Frame frame;
+            while ( toWrite.pop(frame) ) {
+                Clock::time_point t0 = Clock::now();
+                writeFrame(frame, params);
+                busy[2] += secondsSince(t0);
+            }
+        });
+        computeStage([&] ( Frame&& frame ) { toColour.push(std::move(frame)); });
+        toColour.close();
+        colourer.join();
+        writer.join();
+    } else {
+        computeStage([&] ( Frame&& frame ) {
+            Clock::time_point t0 = Clock::now();
+            colourFrame(frame, params.maxIter);
+            Clock::time_point t1 = Clock::now();
+            writeFrame(frame, params);
+            busy[1] += std::chrono::duration<double>(t1 - t0).count();
+            busy[2] += secondsSince(t1);
+        });
+    }
+
+    double wall = secondsSince(start);
+    const char* names[3] = { "calcul", "couleurs", "écriture" };
+    std::cout << "Animation (" << ( params.pipelined ? "pipeline" : "séquentielle" ) << ") : "
+              << params.nbFrames << " images en " << wall << " s, soit "
+              << 60.*params.nbFrames/wall << " images/minute" << std::endl;
+    for ( int s = 0; s < 3; ++s )
+        std::cout << "  Occupation étage " << names[s] << " : " << 100.*busy[s]/wall
+                  << "% (" << busy[s] << " s)" << std::endl;
+    std::cout << "  Pixels repris de l'image précédente : "
+              << 100.*nbReused/(double(params.W)*params.H*params.nbFrames) << "%" << std::endl;
+}
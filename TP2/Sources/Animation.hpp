@@ -0,0 +1,82 @@
+#ifndef _ANIMATION_HPP_
+# define _ANIMATION_HPP_
+# include <condition_variable>
+# include <deque>
+# include <mutex>
+# include <string>
+
+/** File d'attente bornée entre deux étages d'un pipeline : push bloque
+ *  quand la file est pleine, pop bloque quand elle est vide. Après close,
+ *  pop renvoie faux une fois la file vidée.
+ **/
+template<typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue( std::size_t capacity ) : m_capacity(capacity), m_closed(false) {}
+
+    void push( T value )
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] () { return m_items.size() < m_capacity; });
+        m_items.push_back(std::move(value));
+        m_notEmpty.notify_one();
+    }
+
+    bool pop( T& value )
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] () { return m_closed || !m_items.empty(); });
+        if ( m_items.empty() ) return false;
+        value = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+    }
+private:
+    std::size_t m_capacity;
+    bool m_closed;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty, m_notFull;
+};
+
+/** Paramètres d'une animation de zoom : la vue k est centrée en
+ *  (centerRe, centerIm), de largeur 3/(zoom*factor^k), avec des pixels
+ *  carrés ; le pixel (W/2, H/2) est exactement au centre.
+ **/
+struct AnimationParameters
+{
+    double centerRe, centerIm;
+    double zoom, factor;
+    int nbFrames;
+    int W, H, maxIter;
+    bool reuse;     // Reprendre les pixels qui coïncident avec la vue précédente
+    bool pipelined; // Faux : les trois étapes s'enchaînent image par image
+    std::string prefix;
+};
+
+/** Calcule et écrit les images prefix_0000.ppm, prefix_0001.ppm, ...
+ *
+ *  Trois étages reliés par des files bornées : calcul des itérations
+ *  (OpenMP sur les lignes), mise en couleurs et écriture. L'image k+1 est
+ *  ainsi calculée pendant que l'image k est mise en couleurs et écrite.
+ *
+ *  Avec reuse, les pixels de la vue k+1 qui tombent exactement sur un
+ *  pixel de la vue k (même c au bit près) reprennent son nombre
+ *  d'itérations au lieu de le recalculer : l'image est identique, et pour
+ *  factor = 2 un quart des pixels est repris.
+ *
+ *  Affiche le débit en images par minute, le taux d'occupation de chaque
+ *  étage et la proportion de pixels repris.
+ **/
+void renderZoomAnimation( const AnimationParameters& params );
+
+#endif
@@ -0,0 +1,105 @@
+# include <cstdint>
+# include <cstdlib>
+# include "MandelbrotKernel.hpp"
+# include "AntiAliasing.hpp"
+# include "Palette.hpp"
+
+namespace {
+    /* Nombre pseudo-aléatoire dans [0,1[ ne dépendant que de (i, j, s) :
+     * les sous-échantillons d'un pixel sont les mêmes quel que soit le
+     * thread qui le traite, et les mêmes pour les deux versions */
+    double jitter( int i, int j, int s )
+    {
+        std::uint64_t x = (std::uint64_t(std::uint32_t(i)) << 40) ^
+                          (std::uint64_t(std::uint32_t(j)) << 16) ^ std::uint64_t(s);
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return double(x >> 11) * (1./9007199254740992.);
+    }
+
+    /* Couleur moyenne des n x n sous-échantillons du pixel (i,j) */
+    void resamplePixel( int W, int H, int maxIter, int i, int j, int n, unsigned char* rgb )
+    {
+        Complex c  = pixelToComplex(W, H, i, j);
+        Complex c1 = pixelToComplex(W, H, i+1, j+1);
+        double scaleX = c1.real - c.real, scaleY = c1.imag - c.imag;
+        const int nbSamples = n*n;
+        std::vector<double> cre(nbSamples), cim(nbSamples);
+        std::vector<int> res(nbSamples);
+        for ( int a = 0; a < n; ++a )
+            for ( int b = 0; b < n; ++b ) {
+                int s = a*n + b;
+                double dx = (b + jitter(i, j, 2*s  ))/n - 0.5;
+                double dy = (a + jitter(i, j, 2*s+1))/n - 0.5;
+                cre[s] = c.real + dx*scaleX;
+                cim[s] = c.imag + dy*scaleY;
+            }
+        iterMandelbrotPoints(maxIter, nbSamples, cre.data(), cim.data(), res.data());
+        const double scaleCol = 1./maxIter;
+        int sum[3] = { 0, 0, 0 };
+        for ( int s = 0; s < nbSamples; ++s ) {
+            unsigned char col[3];
+            iterToColour(scaleCol, res[s], col);
+            for ( int k = 0; k < 3; ++k ) sum[k] += col[k];
+        }
+        for ( int k = 0; k < 3; ++k )
+            rgb[k] = (unsigned char)((sum[k] + nbSamples/2)/nbSamples);
+    }
+}
+// =====================================================================
+std::vector<unsigned char>
+antiAliasAdaptive( int W, int H, int maxIter, const std::vector<int>& iters,
+                   int n, int threshold, long& nbResampled )
+{
+    std::vector<unsigned char> rgb(3*W*H);
+    std::vector<unsigned char> isEdge(W*H, 0);
+    const double scaleCol = 1./maxIter;
+#   pragma omp parallel
+    {
+#       pragma omp for
+        for ( int k = 0; k < W*H; ++k )
+            iterToColour(scaleCol, iters[k], rgb.data() + 3*k);
+        // Détection des bords sur l'image à un échantillon par pixel
+#       pragma omp for
+        for ( int r = 0; r < H; ++r )
+            for ( int j = 0; j < W; ++j ) {
+                const unsigned char* col = rgb.data() + 3*(W*r+j);
+                bool edge = false;
+                for ( int dr = -1; (dr <= 1) && !edge; ++dr )
+                    for ( int dj = -1; (dj <= 1) && !edge; ++dj ) {
+                        int rr = r + dr, jj = j + dj;
+                        if ( (rr < 0) || (rr >= H) || (jj < 0) || (jj >= W) ) continue;
+                        const unsigned char* other = rgb.data() + 3*(W*rr+jj);
+                        for ( int k = 0; k < 3; ++k )
+                            edge = edge || ( std::abs(int(col[k]) - int(other[k])) > threshold );
+                    }
+                isEdge[W*r+j] = edge;
+            }
+    }
+    // La détection lit les couleurs initiales : on ne les remplace qu'après
+    std::vector<int> edges;
+    for ( int k = 0; k < W*H; ++k )
+        if ( isEdge[k] ) edges.push_back(k);
+    int nbEdges = int(edges.size());
+#   pragma omp parallel for schedule(dynamic,16)
+    for ( int e = 0; e < nbEdges; ++e ) {
+        int k = edges[e];
+        int i = H - 1 - k/W, j = k%W;
+        resamplePixel(W, H, maxIter, i, j, n, rgb.data() + 3*k);
+    }
+    nbResampled = nbEdges;
+    return rgb;
+}
+// ---------------------------------------------------------------------
+std::vector<unsigned char>
+antiAliasUniform( int W, int H, int maxIter, int n )
+{
+    std::vector<unsigned char> rgb(3*W*H);
+#   pragma omp parallel for schedule(dynamic)
+    for ( int i = 0; i < H; ++i )
+        for ( int j = 0; j < W; ++j )
+            resamplePixel(W, H, maxIter, i, j, n, rgb.data() + 3*(W*(H-i-1)+j));
+    return rgb;
+}
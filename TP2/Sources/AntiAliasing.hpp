@@ -0,0 +1,25 @@
+#ifndef _ANTI_ALIASING_HPP_
+# define _ANTI_ALIASING_HPP_
+# include <vector>
+
+/** Anti-crénelage adaptatif.
+ *
+ *  On part de l'image calculée avec un échantillon par pixel (iters,
+ *  même disposition que computeMandelbrotSet : ligne i rangée en
+ *  W*(H-i-1)). Un pixel est un pixel de bord si sa couleur diffère de
+ *  celle d'un de ses 8 voisins de plus de threshold sur une composante.
+ *  Seuls ces pixels sont rééchantillonnés : n x n sous-échantillons
+ *  stratifiés et décalés aléatoirement dans le pixel, dont on moyenne les
+ *  couleurs. Les pixels de bord étant regroupés le long de la frontière,
+ *  ils sont répartis entre les threads par paquets dynamiques.
+ *
+ *  Renvoie l'image en couleurs (3 octets par pixel, même disposition) ;
+ *  nbResampled reçoit le nombre de pixels rééchantillonnés.
+ **/
+std::vector<unsigned char> antiAliasAdaptive( int W, int H, int maxIter, const std::vector<int>& iters,
+                                              int n, int threshold, long& nbResampled );
+
+/** Référence : les n x n mêmes sous-échantillons pour tous les pixels */
+std::vector<unsigned char> antiAliasUniform( int W, int H, int maxIter, int n );
+
+#endif
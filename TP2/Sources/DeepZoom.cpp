@@ -0,0 +1,236 @@
+# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <cstdlib>
+# include <iostream>
+# include <memory>
+# include <stdexcept>
+# include <gmpxx.h>
+# include "DoubleDouble.hpp"
+# include "MandelbrotKernel.hpp"
+# include "DeepZoom.hpp"
+
+namespace {
+    // Erreur relative tolérée sur dz pour l'approximation par série
+    const double seriesTolerance = 1.E-12;
+
+    double toDouble( const char* str, const char* option )
+    {
+        char* end;
+        double val = std::strtod(str, &end);
+        if ( *end != '\0' )
+            throw std::invalid_argument(std::string("Valeur invalide pour ") + option + " : " + str);
+        return val;
+    }
+}
+// =====================================================================
+ViewParameters
+parseViewParameters( int argc, char* argv[] )
+{
+    ViewParameters view;
+    for ( int i = 1; i < argc; ++i ) {
+        std::string arg = argv[i];
+        int nbValues = ( arg == "--center" || arg == "--size" || arg == "--julia" ? 2 :
+                         ( arg == "--zoom" || arg == "--iter" || arg == "--precision" ||
+                           arg == "--fractal" || arg == "--degree" ? 1 : 0 ) );
+        if ( nbValues == 0 ) {
+            view.positional.push_back(arg);
+            continue;
+        }
+        if ( i + nbValues >= argc )
+            throw std::invalid_argument("Valeur manquante pour " + arg);
+        if ( arg == "--center" ) {
+            // Validation seulement : les chaînes sont gardées telles quelles
+            // pour ne rien perdre de leur précision
+            toDouble(argv[i+1], "--center");
+            toDouble(argv[i+2], "--center");
+            view.centerRe = argv[i+1];
+            view.centerIm = argv[i+2];
+            view.custom   = true;
+        } else if ( arg == "--zoom" ) {
+            view.zoom   = toDouble(argv[i+1], "--zoom");
+            view.custom = true;
+            if ( view.zoom <= 0. ) throw std::invalid_argument("Le zoom doit être positif");
+        } else if ( arg == "--size" ) {
+            view.W = int(toDouble(argv[i+1], "--size"));
+            view.H = int(toDouble(argv[i+2], "--size"));
+            if ( view.W < 2 || view.H < 2 ) throw std::invalid_argument("Image trop petite");
+        } else if ( arg == "--precision" ) {
+            view.precision = argv[i+1];
+            if ( (view.precision != "auto") && (view.precision != "float") && (view.precision != "double") &&
+                 (view.precision != "dd") && (view.precision != "perturbation") )
+                throw std::invalid_argument("Précision inconnue : " + view.precision);
+        } else if ( arg == "--fractal" ) {
+            view.fractal = argv[i+1];
+            if ( (view.fractal != "mandelbrot") && (view.fractal != "julia") && (view.fractal != "ship") )
+                throw std::invalid_argument("Fractale inconnue : " + view.fractal);
+        } else if ( arg == "--degree" ) {
+            view.degree = int(toDouble(argv[i+1], "--degree"));
+            if ( view.degree < 2 || view.degree > maxFractalDegree )
+                throw std::invalid_argument("Degré non compilé : " + std::string(argv[i+1]));
+        } else if ( arg == "--julia" ) {
+            view.juliaRe = toDouble(argv[i+1], "--julia");
+            view.juliaIm = toDouble(argv[i+2], "--julia");
+            view.fractal = "julia";
+        } else {
+            view.maxIter = int(toDouble(argv[i+1], "--iter"));
+            if ( view.maxIter < 1 ) throw std::invalid_argument("Nombre d'itérations invalide");
+        }
+        i += nbValues;
+    }
+    return view;
+}
+// ---------------------------------------------------------------------
+bool
+installView( const ViewParameters& view, bool verbose )
+{
+    const std::string& prec = view.precision;
+    Fractal fractal{ ( view.fractal == "julia" ? julia_fractal :
+                       ( view.fractal == "ship" ? burning_ship_fractal : mandelbrot_fractal ) ),
+                     view.degree, view.juliaRe, view.juliaIm };
+    setFractal(fractal);
+    // Sans --center ni --zoom, on garde exactement la vue historique
+    if ( !view.custom && (prec == "auto" || prec == "double" || prec == "float") ) {
+        setPrecision( prec == "float" ? single_precision : double_precision );
+        return false;
+    }
+    // Pixels carrés, largeur 3/zoom, centre au milieu de l'image
+    double spacing = 3./(view.zoom*(view.W-1));
+    double cx = std::strtod(view.centerRe.c_str(), nullptr);
+    double cy = std::strtod(view.centerIm.c_str(), nullptr);
+    double halfW = 0.5*spacing*(view.W-1), halfH = 0.5*spacing*(view.H-1);
+    double magnitude = std::max(std::abs(cx) + halfW, std::abs(cy) + halfH);
+    std::string choice = prec;
+    if ( choice == "auto" ) {
+        precision p = selectPrecision(magnitude, spacing);
+        choice = ( p == double_double && !precisionResolves(p, magnitude, spacing) ? "perturbation"
+                                                                                  : precisionName(p) );
+    }
+    if ( !isQuadraticMandelbrot(fractal) && choice != "float" && choice != "double" )
+        throw std::invalid_argument("Précision " + choice + " : seulement pour z*z + c");
+    if ( verbose )
+        std::cout << "Précision : " << choice << ( prec == "auto" ? " (auto)" : "" ) << std::endl;
+    if ( choice == "float" || choice == "double" ) {
+        setPrecision( choice == "float" ? single_precision : double_precision );
+        setViewport(cx-halfW, cx+halfW, cy-halfH, cy+halfH);
+        return false;
+    }
+    if ( choice == "dd" ) {
+        // Centre en double-double (GMP pour lire tous ses chiffres), puis
+        // c = centre + écart au centre : l'écart, petit, est exact en double
+        // à l'arrondi près de spacing
+        mpf_class re(view.centerRe, 128), im(view.centerIm, 128);
+        DoubleDouble xc{re.get_d(), 0.}, yc{im.get_d(), 0.};
+        xc.lo = mpf_class(re - xc.hi).get_d();
+        yc.lo = mpf_class(im - yc.hi).get_d();
+        setRowRenderer([xc, yc, spacing]( int W, int H, int maxIter, int num_ligne, int* pixels ) {
+            std::vector<double> creHi(W), creLo(W), cimHi(W), cimLo(W);
+            DoubleDouble ci = yc + ddFromDouble((num_ligne - 0.5*(H-1))*spacing);
+            for ( int j = 0; j < W; ++j ) {
+                DoubleDouble cr = xc + ddFromDouble((j - 0.5*(W-1))*spacing);
+                creHi[j] = cr.hi; creLo[j] = cr.lo;
+                cimHi[j] = ci.hi; cimLo[j] = ci.lo;
+            }
+            iterMandelbrotPointsDD(maxIter, W, creHi.data(), creLo.data(), cimHi.data(), cimLo.data(),
+                                   pixels);
+        });
+        return true;
+    }
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    std::shared_ptr<DeepZoom> zoom = std::make_shared<DeepZoom>(view);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    if ( verbose )
+        std::cout << "Orbite de référence : " << zoom->referenceLength() << " itérations, "
+                  << zoom->skippedIterations() << " sautées par la série, calculée en "
+                  << elapsed_seconds.count() << " s" << std::endl;
+    setRowRenderer([zoom]( int W, int H, int, int num_ligne, int* pixels ) {
+        if ( W != zoom->width() || H != zoom->height() )
+            throw std::logic_error("Taille d'image différente de celle de la vue");
+        zoom->computeRow(num_ligne, pixels);
+    });
+    return true;
+}
+// =====================================================================
+DeepZoom::DeepZoom( const ViewParameters& view ) :
+    m_W(view.W), m_H(view.H), m_maxIter(view.maxIter),
+    m_spacing(3./(view.zoom*(view.W-1))),
+    m_skip(0), m_Ar(0.), m_Ai(0.), m_Br(0.), m_Bi(0.), m_Cr(0.), m_Ci(0.)
+{
+    // Orbite de référence : il faut distinguer deux pixels voisins, plus
+    // une marge pour les erreurs d'arrondi accumulées le long de l'orbite
+    mp_bitcnt_t prec = 64 + mp_bitcnt_t(std::max(0., std::log2(view.zoom*view.W)));
+    mpf_class cr(view.centerRe, prec), ci(view.centerIm, prec);
+    mpf_class zr(0, prec), zi(0, prec), tmp(0, prec);
+    m_Zr.reserve(m_maxIter+1);
+    m_Zi.reserve(m_maxIter+1);
+    m_Zr.push_back(0.);
+    m_Zi.push_back(0.);
+    for ( int n = 0; n < m_maxIter; ++n ) {
+        tmp = zr*zr - zi*zi + cr;
+        zi  = 2*zr*zi + ci;
+        zr  = tmp;
+        double dr = zr.get_d(), di = zi.get_d();
+        m_Zr.push_back(dr);
+        m_Zi.push_back(di);
+        if ( dr*dr + di*di >= 4. ) break;
+    }
+    // Approximation par série : A_{n+1} = 2 Z_n A_n + 1,
+    // B_{n+1} = 2 Z_n B_n + A_n^2, C_{n+1} = 2 Z_n C_n + 2 A_n B_n.
+    // On avance tant que le terme en C, pour le |dc| le plus grand de
+    // l'image (un coin), reste négligeable devant le terme en A et que
+    // l'orbite de référence reste assez loin du disque de rayon 2 pour
+    // qu'aucun pixel ne puisse diverger pendant les itérations sautées.
+    double dcMax = 0.5*m_spacing*std::hypot(double(m_W-1), double(m_H-1));
+    double Ar = 0., Ai = 0., Br = 0., Bi = 0., Cr = 0., Ci = 0.;
+    int L = referenceLength();
+    for ( int n = 0; n + 1 < L; ++n ) {
+        double Zr2 = 2.*m_Zr[n], Zi2 = 2.*m_Zi[n];
+        double nAr = Zr2*Ar - Zi2*Ai + 1.;
+        double nAi = Zr2*Ai + Zi2*Ar;
+        double nBr = Zr2*Br - Zi2*Bi + Ar*Ar - Ai*Ai;
+        double nBi = Zr2*Bi + Zi2*Br + 2.*Ar*Ai;
+        double nCr = Zr2*Cr - Zi2*Ci + 2.*(Ar*Br - Ai*Bi);
+        double nCi = Zr2*Ci + Zi2*Cr + 2.*(Ar*Bi + Ai*Br);
+        double a = std::hypot(nAr, nAi)*dcMax;
+        double c = std::hypot(nCr, nCi)*dcMax*dcMax*dcMax;
+        if ( !(c <= seriesTolerance*a) ) break;
+        if ( std::hypot(m_Zr[n+1], m_Zi[n+1]) + 2.*a >= 2. ) break;
+        Ar = nAr; Ai = nAi; Br = nBr; Bi = nBi; Cr = nCr; Ci = nCi;
+        m_skip = n+1;
+    }
+    m_Ar = Ar; m_Ai = Ai; m_Br = Br; m_Bi = Bi; m_Cr = Cr; m_Ci = Ci;
+}
+// ---------------------------------------------------------------------
+void
+DeepZoom::computeRow( int num_ligne, int* pixels ) const
+{
+    const int L = referenceLength();
+    const double* Zr = m_Zr.data();
+    const double* Zi = m_Zi.data();
+    double dci = (num_ligne - 0.5*(m_H-1))*m_spacing;
+    for ( int j = 0; j < m_W; ++j ) {
+        double dcr = (j - 0.5*(m_W-1))*m_spacing;
+        // dz en m_skip par la série (schéma de Horner)
+        double tr = m_Cr*dcr - m_Ci*dci + m_Br, ti = m_Cr*dci + m_Ci*dcr + m_Bi;
+        double ur = tr*dcr - ti*dci + m_Ar,     ui = tr*dci + ti*dcr + m_Ai;
+        double dzr = ur*dcr - ui*dci,           dzi = ur*dci + ui*dcr;
+        int n = m_skip, m = m_skip;
+        while ( n < m_maxIter ) {
+            double zr = Zr[m] + dzr, zi = Zi[m] + dzi;
+            double zn = zr*zr + zi*zi;
+            if ( zn >= 4. ) break;
+            if ( zn < dzr*dzr + dzi*dzi || m == L ) {
+                // Rebasage sur le début de l'orbite de référence (Z_0 = 0)
+                dzr = zr; dzi = zi; m = 0;
+            }
+            double ar = 2.*Zr[m] + dzr, ai = 2.*Zi[m] + dzi;
+            double tmp = ar*dzr - ai*dzi + dcr;
+            dzi = ar*dzi + ai*dzr + dci;
+            dzr = tmp;
+            ++m; ++n;
+        }
+        pixels[j] = n;
+    }
+}
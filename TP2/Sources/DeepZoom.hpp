@@ -0,0 +1,95 @@
+#ifndef _DEEP_ZOOM_HPP_
+# define _DEEP_ZOOM_HPP_
+# include <string>
+# include <vector>
+
+/** Vue demandée sur la ligne de commande :
+ *    --center re im : centre de la vue, en décimal avec autant de chiffres
+ *                     que nécessaire pour le zoom demandé ;
+ *    --zoom z       : facteur de zoom (1 = largeur 3, comme la vue par défaut) ;
+ *    --size W H     : taille de l'image en pixels ;
+ *    --iter n       : nombre maximal d'itérations ;
+ *    --precision p  : auto (défaut), float, double, dd (double-double) ou
+ *                     perturbation ;
+ *    --fractal f    : mandelbrot (défaut), julia ou ship (Burning Ship) ;
+ *    --degree d     : degré de z^d, de 2 (défaut) à maxFractalDegree ;
+ *    --julia re im  : constante des ensembles de Julia (implique --fractal julia).
+ *  Les autres arguments sont rangés, dans l'ordre, dans positional.
+ **/
+struct ViewParameters
+{
+    std::string centerRe = "-0.5", centerIm = "0";
+    double zoom = 1.;
+    int W = 800, H = 600;
+    int maxIter = 8*65536;
+    std::string precision = "auto";
+    std::string fractal = "mandelbrot";
+    int degree = 2;
+    double juliaRe = -0.8, juliaIm = 0.156;
+    bool custom = false; // Vrai si --center ou --zoom a été donné
+    std::vector<std::string> positional;
+};
+
+ViewParameters parseViewParameters( int argc, char* argv[] );
+
+/** Prépare le calcul de la vue. En précision auto, on prend la moins
+ *  coûteuse qui résout l'écart entre deux pixels (selectPrecision) :
+ *    - float ou double : simple changement de fenêtre (setViewport et
+ *      setPrecision) ;
+ *    - double-double : points calculés en double-double autour du centre
+ *      (setRowRenderer) ;
+ *    - au-delà, zoom profond par perturbation (setRowRenderer).
+ *  Renvoie vrai si un renderer remplace le calcul standard. verbose
+ *  affiche la précision retenue et les caractéristiques de l'orbite de
+ *  référence.
+ *
+ *  La fractale choisie est installée par setFractal ; les précisions
+ *  double-double et perturbation ne traitent que z*z + c (exception
+ *  std::invalid_argument sinon).
+ *
+ *  Sans --center, --zoom ni --precision, la vue historique est gardée
+ *  telle quelle (en double). Dans tous les cas, c'est toujours
+ *  computeMandelbrotSetRow qui calcule une ligne : les découpages
+ *  parallèles existants (OpenMP, maître-esclave MPI, hybride)
+ *  s'appliquent tels quels.
+ **/
+bool installView( const ViewParameters& view, bool verbose = true );
+
+/** Zoom profond par la méthode des perturbations.
+ *
+ *  Une seule orbite de référence Z_n, celle du centre de la vue, est
+ *  calculée en haute précision (GMP, précision adaptée au zoom). Chaque
+ *  pixel c = Z_0 + dc ne calcule que son écart dz_n à cette orbite, en
+ *  double :
+ *      dz_{n+1} = (2 Z_n + dz_n) dz_n + dc
+ *  Les premières itérations, communes à toute l'image, sont sautées grâce
+ *  à l'approximation par série dz_n ~ A_n dc + B_n dc^2 + C_n dc^3, valable
+ *  tant que le terme en C reste négligeable devant celui en A.
+ *
+ *  Un pixel dont l'orbite passe plus près de 0 que de l'orbite de
+ *  référence (|Z_m + dz| < |dz|) perdrait toute précision ("glitch") : on
+ *  le rebase alors sur le début de la référence (dz = z, m = 0). On
+ *  rebase de même quand la référence a divergé avant le pixel.
+ *
+ *  Les écarts sont des doubles : le zoom est limité à environ 1e290.
+ **/
+class DeepZoom
+{
+public:
+    DeepZoom( const ViewParameters& view );
+
+    void computeRow( int num_ligne, int* pixels ) const;
+
+    int width()             const { return m_W; }
+    int height()            const { return m_H; }
+    int referenceLength()   const { return int(m_Zr.size()) - 1; }
+    int skippedIterations() const { return m_skip; }
+private:
+    int m_W, m_H, m_maxIter;
+    double m_spacing;                // Distance entre deux pixels
+    std::vector<double> m_Zr, m_Zi;  // Orbite de référence arrondie en double
+    int m_skip;                      // Itérations sautées par la série
+    double m_Ar, m_Ai, m_Br, m_Bi, m_Cr, m_Ci; // Coefficients de la série en m_skip
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _DOUBLE_DOUBLE_HPP_
+# define _DOUBLE_DOUBLE_HPP_
+
+/** Nombre double-double : hi + lo avec |lo| <= ulp(hi)/2, soit environ
+ *  106 bits de mantisse (32 chiffres) avec l'exposant d'un double.
+ *
+ *  Les opérations suivent les algorithmes classiques (Dekker, Knuth) :
+ *  two_sum donne l'erreur exacte d'une addition, fma celle d'un produit.
+ *  Elles n'utilisent que des opérations élémentaires sur des doubles et
+ *  se vectorisent donc comme elles ; il faut seulement que le compilateur
+ *  ne les réarrange pas (pas de -ffast-math) ni ne fusionne lui-même des
+ *  produits et sommes en FMA (-ffp-contract=off dans le Makefile).
+ **/
+struct DoubleDouble
+{
+    double hi, lo;
+};
+
+inline DoubleDouble ddFromDouble( double x ) { return DoubleDouble{x, 0.}; }
+
+/* Somme exacte a + b = s + e, quels que soient a et b */
+inline DoubleDouble ddTwoSum( double a, double b )
+{
+    double s  = a + b;
+    double bb = s - a;
+    double e  = (a - (s - bb)) + (b - bb);
+    return DoubleDouble{s, e};
+}
+
+/* Somme exacte a + b = s + e quand |a| >= |b| */
+inline DoubleDouble ddQuickTwoSum( double a, double b )
+{
+    double s = a + b;
+    return DoubleDouble{s, b - (s - a)};
+}
+
+inline DoubleDouble operator + ( const DoubleDouble& x, const DoubleDouble& y )
+{
+    DoubleDouble s = ddTwoSum(x.hi, y.hi);
+    DoubleDouble t = ddTwoSum(x.lo, y.lo);
+    s.lo += t.hi;
+    s = ddQuickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return ddQuickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator - ( const DoubleDouble& x )
+{
+    return DoubleDouble{-x.hi, -x.lo};
+}
+
+inline DoubleDouble operator - ( const DoubleDouble& x, const DoubleDouble& y )
+{
+    return x + (-y);
+}
+
+inline DoubleDouble operator * ( const DoubleDouble& x, const DoubleDouble& y )
+{
+    double p = x.hi*y.hi;
+    double e = __builtin_fma(x.hi, y.hi, -p);
+    e += x.hi*y.lo + x.lo*y.hi;
+    return ddQuickTwoSum(p, e);
+}
+
+/* 2x, exact */
+inline DoubleDouble ddTwice( const DoubleDouble& x )
+{
+    return DoubleDouble{x.hi + x.hi, x.lo + x.lo};
+}
+
+inline DoubleDouble ddSqr( const DoubleDouble& x )
+{
+    double p = x.hi*x.hi;
+    double e = __builtin_fma(x.hi, x.hi, -p);
+    e += 2.*x.hi*x.lo;
+    return ddQuickTwoSum(p, e);
+}
+
+#endif
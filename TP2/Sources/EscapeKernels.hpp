@@ -0,0 +1,101 @@
+#ifndef _ESCAPE_KERNELS_HPP_
+# define _ESCAPE_KERNELS_HPP_
+# include "MandelbrotKernel.hpp"
+
+/** Famille de fractales à temps d'échappement : une itération est
+ *  décrite par un objet "étape" passé en paramètre de modèle aux noyaux
+ *  génériques de MandelbrotKernel.cpp, qui restent seuls à gérer les
+ *  voies, l'échappement et la détection de cycle.
+ *
+ *  T donne les opérations sur le type Real (sqr, twice, abs), comme
+ *  RealTraits dans MandelbrotKernel.cpp.
+ **/
+
+/** z^d par exponentiation binaire, développée à la compilation :
+ *  z^(2k) = (z^k)^2 et z^(2k+1) = z^(2k) z, jusqu'à z^2 dont on reprend
+ *  x2 = x*x et y2 = y*y déjà calculés pour le test d'échappement. Ainsi
+ *  z^2 coûte 1 produit, z^3 5, z^4 4, z^8 7, sans boucle ni branchement.
+ **/
+template<int d, bool even = (d % 2 == 0)> struct ComplexPower;
+
+template<> struct ComplexPower<1, false>
+{
+    template<typename T, typename Real>
+    static void apply( Real x, Real y, Real, Real, Real& pr, Real& pi )
+    {
+        pr = x; pi = y;
+    }
+};
+
+template<> struct ComplexPower<2, true>
+{
+    template<typename T, typename Real>
+    static void apply( Real x, Real y, Real x2, Real y2, Real& pr, Real& pi )
+    {
+        pr = x2 - y2;
+        pi = T::twice(x*y);
+    }
+};
+
+template<int d> struct ComplexPower<d, true>
+{
+    template<typename T, typename Real>
+    static void apply( Real x, Real y, Real x2, Real y2, Real& pr, Real& pi )
+    {
+        Real hr, hi;
+        ComplexPower<d/2>::template apply<T>(x, y, x2, y2, hr, hi);
+        pr = T::sqr(hr) - T::sqr(hi);
+        pi = T::twice(hr*hi);
+    }
+};
+
+template<int d> struct ComplexPower<d, false>
+{
+    template<typename T, typename Real>
+    static void apply( Real x, Real y, Real x2, Real y2, Real& pr, Real& pi )
+    {
+        Real hr, hi;
+        ComplexPower<d-1>::template apply<T>(x, y, x2, y2, hr, hi);
+        pr = hr*x - hi*y;
+        pi = hr*y + hi*x;
+    }
+};
+
+/** Une étape z -> f(z) + c de la variante V en degré d :
+ *    - mandelbrot_fractal   : z_0 = 0, c = point, f(z) = z^d ;
+ *    - julia_fractal        : z_0 = point, c = (jr, ji), f(z) = z^d ;
+ *    - burning_ship_fractal : z_0 = 0, c = point, f(z) = (|x| + i|y|)^d.
+ *  Pour d = 2 et la variante mandelbrot_fractal, ce sont exactement les
+ *  opérations du noyau quadratique écrit à la main.
+ **/
+template<fractal_variant V, int d, typename Real, typename T>
+struct EscapeStep
+{
+    Real jr, ji;
+
+    void start( Real a, Real b, Real& zr, Real& zi, Real& cr, Real& ci ) const
+    {
+        if ( V == julia_fractal ) {
+            zr = a;  zi = b;
+            cr = jr; ci = ji;
+        } else {
+            zr = T::zero(); zi = T::zero();
+            cr = a; ci = b;
+        }
+    }
+
+    /* (nzr, nzi) = f(a + ib) + c, avec a2 = a*a et b2 = b*b */
+    void next( Real a, Real b, Real a2, Real b2, Real cr, Real ci, Real& nzr, Real& nzi ) const
+    {
+        if ( V == burning_ship_fractal ) {
+            a = T::abs(a);
+            b = T::abs(b);
+        }
+        Real pr, pi;
+        ComplexPower<d>::template apply<T>(a, b, a2, b2, pr, pi);
+        nzi = pi + ci;
+        nzr = pr + cr;
+    }
+};
+
+#endif
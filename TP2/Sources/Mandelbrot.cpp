@@ -5,105 +5,197 @@
 # include <cmath>
 # include <vector>
 # include <fstream>
+# include "MandelbrotKernel.hpp"
+# include "MarianiSilver.hpp"
+# include "DeepZoom.hpp"
+# include "Animation.hpp"
+# include "AntiAliasing.hpp"
+# include "Palette.hpp"
 
 
-/** Une structure complexe est définie pour la bonne raison que la classe
- * complex proposée par g++ est très lente ! Le calcul est bien plus rapide
- * avec la petite structure donnée ci--dessous
- **/
-struct Complex
+std::vector<int>
+computeMandelbrotSet( int W, int H, int maxIter )
 {
-    Complex() : real(0.), imag(0.)
-    {}
-    Complex(double r, double i) : real(r), imag(i)
-    {}
-    Complex operator + ( const Complex& z )
-    {
-        return Complex(real + z.real, imag + z.imag );
-    }
-    Complex operator * ( const Complex& z )
-    {
-        return Complex(real*z.real-imag*z.imag, real*z.imag+imag*z.real);
-    }
-    double sqNorm() { return real*real + imag*imag; }
-    double real,imag;
-};
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    std::vector<int> pixels(W*H);
+    start = std::chrono::system_clock::now();
+    // On parcourt les pixels de l'espace image :
+    for ( int i = 0; i < H; ++i ) {
+      computeMandelbrotSetRow(W, H, maxIter, i, pixels.data() + W*(H-i-1) );
+    }
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
+              << std::endl;
+    return pixels;
+}
 
-std::ostream& operator << ( std::ostream& out, const Complex& c )
+/** Même calcul par l'algorithme de Mariani-Silver : affiche le temps de
+ *  calcul et la proportion de pixels réellement itérés
+ **/
+std::vector<int>
+computeMandelbrotSetMS( int W, int H, int maxIter )
 {
-  out << "(" << c.real << "," << c.imag << ")" << std::endl;
-  return out;
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    long nbIterated;
+    start = std::chrono::system_clock::now();
+    auto pixels = computeMandelbrotSetMarianiSilver(W, H, maxIter, nbIterated);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot (Mariani-Silver) : " << elapsed_seconds.count()
+              << std::endl;
+    std::cout << "Pixels itérés : " << nbIterated << " / " << W*H << " ("
+              << 100.*nbIterated/(double(W)*H) << "%)" << std::endl;
+    return pixels;
 }
 
-/** Pour un c complexe donné, calcul le nombre d'itérations de mandelbrot
- * nécessaires pour détecter une éventuelle divergence. Si la suite
- * converge, la fonction retourne la valeur maxIter
+/** Mesure l'effet de la détection de cycle sur une vue dominée par des
+ *  points intérieurs non couverts par les tests de zones connues (bulbes
+ *  de période 5 et leurs décorations autour de -0.5+0.56i)
  **/
-int iterMandelbrot( int maxIter, const Complex& c)
+void
+benchPeriodicity( int W, int H, int maxIter )
 {
-    Complex z{0.,0.};
-    // On vérifie dans un premier temps si le complexe
-    // n'appartient pas à une zone de convergence connue :
-    // Appartenance aux disques  C0{(0,0),1/4} et C1{(-1,0),1/4}
-    if ( c.real*c.real+c.imag*c.imag < 0.0625 )
-        return maxIter;
-    if ( (c.real+1)*(c.real+1)+c.imag*c.imag < 0.0625 )
-        return maxIter;
-    // Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))}    
-    if ((c.real > -0.75) && (c.real < 0.5) ) {
-        Complex ct{c.real-0.25,c.imag};
-        double ctnrm2 = sqrt(ct.sqNorm());
-        if (ctnrm2 < 0.5*(1-ct.real/ctnrm2)) return maxIter;
-    }
-    int niter = 0;
-    while ((z.sqNorm() < 4.) && (niter < maxIter))
-    {
-        z = z*z + c;
-        ++niter;
-    }
-    return niter;
+    const double xmin = -0.56, xmax = -0.45, ymin = 0.52, ymax = 0.60;
+    std::vector<double> cre(W*H), cim(W*H);
+    for ( int i = 0; i < H; ++i )
+        for ( int j = 0; j < W; ++j ) {
+            cre[i*W+j] = xmin + j*(xmax-xmin)/(W-1);
+            cim[i*W+j] = ymin + i*(ymax-ymin)/(H-1);
+        }
+    std::vector<int> withCycles(W*H), withoutCycles(W*H);
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    std::chrono::duration<double> elapsed_seconds;
+    for ( int pass = 0; pass < 2; ++pass ) {
+        setPeriodicityCheck(pass == 0);
+        start = std::chrono::system_clock::now();
+        iterMandelbrotPoints(maxIter, W*H, cre.data(), cim.data(),
+                             ( pass == 0 ? withCycles : withoutCycles ).data());
+        end = std::chrono::system_clock::now();
+        elapsed_seconds = end-start;
+        std::cout << "Temps vue intérieure " << ( pass == 0 ? "avec" : "sans" )
+                  << " détection de cycle : " << elapsed_seconds.count() << std::endl;
+    }
+    setPeriodicityCheck(true);
+    long nbInterior = 0, nbDiffs = 0;
+    for ( int i = 0; i < W*H; ++i ) {
+        nbInterior += ( withoutCycles[i] == maxIter );
+        nbDiffs    += ( withCycles[i] != withoutCycles[i] );
+    }
+    std::cout << "Pixels intérieurs : " << 100.*nbInterior/(double(W)*H) << "%, pixels différents : "
+              << nbDiffs << std::endl;
 }
 
-/**
- * On parcourt chaque pixel de l'espace image et on fait correspondre par
- * translation et homothétie une valeur complexe c qui servira pour
- * itérer sur la suite de Mandelbrot. Le nombre d'itérations renvoyé
- * servira pour construire l'image finale.
- 
- Sortie : un vecteur de taille W*H avec pour chaque case un nombre d'étape de convergence de 0 à maxIter
- MODIFICATION DE LA FONCTION :
- j'ai supprimé le paramètre W étant donné que maintenant, cette fonction ne prendra plus que des lignes de taille W en argument.
+/** Débit de la boucle d'échappement pour chaque précision (float, double,
+ *  double-double) sur les pixels de la vue courante, et nombre de pixels
+ *  qui diffèrent du calcul en double
  **/
-void 
-computeMandelbrotSetRow( int W, int H, int maxIter, int num_ligne, int* pixels)
+void
+benchPrecision( int W, int H, int maxIter )
 {
-    // Calcul le facteur d'échelle pour rester dans le disque de rayon 2
-    // centré en (0,0)
-    double scaleX = 3./(W-1);
-    double scaleY = 2.25/(H-1.);
-    //
-    // On parcourt les pixels de l'espace image :
-    for ( int j = 0; j < W; ++j ) {
-       Complex c{-2.+j*scaleX,-1.125+ num_ligne*scaleY};
-       pixels[j] = iterMandelbrot( maxIter, c );
+    std::vector<double> cre(W*H), cim(W*H), zeros(W*H, 0.);
+    for ( int i = 0; i < H; ++i )
+        for ( int j = 0; j < W; ++j ) {
+            Complex c = pixelToComplex(W, H, i, j);
+            cre[i*W+j] = c.real;
+            cim[i*W+j] = c.imag;
+        }
+    const precision precs[3] = { single_precision, double_precision, double_double };
+    std::vector<int> iters[3];
+    double times[3];
+    for ( int p = 0; p < 3; ++p ) {
+        iters[p].resize(W*H);
+        std::chrono::time_point<std::chrono::system_clock> start, end;
+        start = std::chrono::system_clock::now();
+        if ( precs[p] == double_double )
+            iterMandelbrotPointsDD(maxIter, W*H, cre.data(), zeros.data(), cim.data(), zeros.data(),
+                                   iters[p].data());
+        else {
+            setPrecision(precs[p]);
+            iterMandelbrotPoints(maxIter, W*H, cre.data(), cim.data(), iters[p].data());
+        }
+        end = std::chrono::system_clock::now();
+        std::chrono::duration<double> elapsed_seconds = end-start;
+        times[p] = elapsed_seconds.count();
+    }
+    for ( int p = 0; p < 3; ++p )
+        std::cout << "Précision " << precisionName(precs[p]) << " : " << times[p] << " s, "
+                  << 1.E-6*W*H/times[p] << " Mpixels/s, " << times[1]/times[p]
+                  << " fois le débit en double" << std::endl;
+    setPrecision(double_precision);
+    for ( int p = 0; p < 3; p += 2 ) {
+        long nbDiffs = 0;
+        for ( int k = 0; k < W*H; ++k ) nbDiffs += ( iters[p][k] != iters[1][k] );
+        std::cout << "Pixels différents du double en " << precisionName(precs[p]) << " : "
+                  << nbDiffs << std::endl;
     }
 }
 
-std::vector<int>
-computeMandelbrotSet( int W, int H, int maxIter )
+/** Coût des noyaux de la famille de fractales (EscapeKernels.hpp) sur
+ *  les pixels de la vue courante : z*z + c par iterMandelbrotPoints puis
+ *  par iterEscapePoints en degré 2 (mêmes résultats, même débit attendu),
+ *  puis Multibrot de degré 3 à maxFractalDegree, Julia et Burning Ship.
+ *  Sans détection de cycle, meilleur temps de trois essais.
+ **/
+void
+benchFractals( int W, int H, int maxIter )
 {
-    std::chrono::time_point<std::chrono::system_clock> start, end;
-    std::vector<int> pixels(W*H);
-    start = std::chrono::system_clock::now();
-    // On parcourt les pixels de l'espace image :
-    for ( int i = 0; i < H; ++i ) {
-      computeMandelbrotSetRow(W, H, maxIter, i, pixels.data() + W*(H-i-1) );
+    std::vector<double> cre(W*H), cim(W*H);
+    for ( int i = 0; i < H; ++i )
+        for ( int j = 0; j < W; ++j ) {
+            Complex c = pixelToComplex(W, H, i, j);
+            cre[i*W+j] = c.real;
+            cim[i*W+j] = c.imag;
+        }
+    const Fractal saved = getFractal();
+    const Fractal quadratic{ mandelbrot_fractal, 2, 0., 0. };
+    setFractal(quadratic);
+    setPeriodicityCheck(false);
+    // Meilleur temps de trois essais de compute (résultats dans iters)
+    auto bestTime = [&] ( const std::function<void(int*)>& compute, std::vector<int>& iters ) {
+        iters.resize(W*H);
+        double best = 0.;
+        for ( int trial = 0; trial < 3; ++trial ) {
+            std::chrono::time_point<std::chrono::system_clock> start, end;
+            start = std::chrono::system_clock::now();
+            compute(iters.data());
+            end = std::chrono::system_clock::now();
+            std::chrono::duration<double> elapsed_seconds = end-start;
+            if ( trial == 0 || elapsed_seconds.count() < best ) best = elapsed_seconds.count();
+        }
+        return best;
+    };
+    std::vector<int> quadraticIters, generic;
+    double tQuadratic = bestTime([&] ( int* res ) {
+            iterMandelbrotPoints(maxIter, W*H, cre.data(), cim.data(), res);
+        }, quadraticIters);
+    double tGeneric = bestTime([&] ( int* res ) {
+            iterEscapePoints(quadratic, maxIter, W*H, cre.data(), cim.data(), res);
+        }, generic);
+    long nbDiffs = 0;
+    for ( int k = 0; k < W*H; ++k ) nbDiffs += ( quadraticIters[k] != generic[k] );
+    std::cout << "z^2+c (iterMandelbrotPoints) : " << tQuadratic << " s, " << 1.E-6*W*H/tQuadratic
+              << " Mpixels/s" << std::endl;
+    std::cout << "z^2+c (iterEscapePoints) : " << tGeneric << " s, " << 1.E-6*W*H/tGeneric
+              << " Mpixels/s, " << tGeneric/tQuadratic << " fois le temps, pixels différents : "
+              << nbDiffs << std::endl;
+    std::vector<Fractal> family;
+    for ( int d = 3; d <= maxFractalDegree; ++d )
+        family.push_back(Fractal{ mandelbrot_fractal, d, 0., 0. });
+    family.push_back(Fractal{ julia_fractal, 2, -0.8, 0.156 });
+    family.push_back(Fractal{ burning_ship_fractal, 2, 0., 0. });
+    for ( const Fractal& fractal : family ) {
+        double t = bestTime([&] ( int* res ) {
+                iterEscapePoints(fractal, maxIter, W*H, cre.data(), cim.data(), res);
+            }, generic);
+        long nbIters = 0;
+        for ( int k = 0; k < W*H; ++k ) nbIters += generic[k];
+        std::cout << fractalVariantName(fractal.variant) << " degré " << fractal.degree << " : " << t
+                  << " s, " << 1.E-6*W*H/t << " Mpixels/s, " << 1.E-6*nbIters/t
+                  << " M itérations/s" << std::endl;
     }
-    end = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
-    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
-              << std::endl;
-    return pixels;
+    setPeriodicityCheck(true);
+    setFractal(saved);
 }
 
 /** Construit et sauvegarde l'image finale **/
@@ -114,25 +206,168 @@ void savePicture( const std::string& filename, int W, int H, const std::vector<i
     ofs << "P6\n"
         << W << " " << H << "\n255\n";
     for ( int i = 0; i < W * H; ++i ) {
-        double iter = scaleCol*nbIters[i];
-        unsigned char r = (unsigned char)(256 - (unsigned (iter*256.) & 0xFF));
-        unsigned char b = (unsigned char)(256 - (unsigned (iter*65536) & 0xFF));
-        unsigned char g = (unsigned char)(256 - (unsigned( iter*16777216) & 0xFF));
-        ofs << r << g << b;
+        unsigned char rgb[3];
+        iterToColour(scaleCol, nbIters[i], rgb);
+        ofs << rgb[0] << rgb[1] << rgb[2];
     }
     ofs.close();
 }
 
+/** Sauvegarde une image déjà en couleurs (3 octets par pixel) **/
+void saveRGB( const std::string& filename, int W, int H, const std::vector<unsigned char>& rgb )
+{
+    std::ofstream ofs( filename.c_str(), std::ios::out | std::ios::binary );
+    ofs << "P6\n"
+        << W << " " << H << "\n255\n";
+    ofs.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    ofs.close();
+}
+
+/** Écart moyen (par composante) entre deux images en couleurs **/
+double meanColourError( const std::vector<unsigned char>& a, const std::vector<unsigned char>& b )
+{
+    double sum = 0.;
+    for ( std::size_t k = 0; k < a.size(); ++k ) sum += std::abs(int(a[k]) - int(b[k]));
+    return sum/a.size();
+}
+
+/** Anti-crénelage adaptatif de l'image iters (n x n sous-échantillons
+ *  par pixel de bord) ; avec compare, calcul aussi de la référence
+ *  uniforme pour comparer coût et qualité
+ **/
+void
+renderAntiAliased( int W, int H, int maxIter, const std::vector<int>& iters, int n, int threshold,
+                   bool compare )
+{
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    long nbResampled;
+    start = std::chrono::system_clock::now();
+    auto rgb = antiAliasAdaptive(W, H, maxIter, iters, n, threshold, nbResampled);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    double adaptiveTime = elapsed_seconds.count();
+    std::cout << "Temps anti-crénelage adaptatif (" << n << "x" << n << ") : " << adaptiveTime
+              << std::endl;
+    std::cout << "Pixels rééchantillonnés : " << nbResampled << " / " << W*H << " ("
+              << 100.*nbResampled/(double(W)*H) << "%)" << std::endl;
+    if ( compare ) {
+        start = std::chrono::system_clock::now();
+        auto reference = antiAliasUniform(W, H, maxIter, n);
+        end = std::chrono::system_clock::now();
+        elapsed_seconds = end-start;
+        std::cout << "Temps suréchantillonnage uniforme (" << n << "x" << n << ") : "
+                  << elapsed_seconds.count() << std::endl;
+        std::vector<unsigned char> single(3*W*H);
+        for ( int k = 0; k < W*H; ++k ) iterToColour(1./maxIter, iters[k], single.data() + 3*k);
+        std::cout << "Écart moyen à l'uniforme : un échantillon " << meanColourError(single, reference)
+                  << ", adaptatif " << meanColourError(rgb, reference) << std::endl;
+    }
+    saveRGB("mandelbrot.ppm", W, H, rgb);
+}
+
 int main(int argc, char *argv[] ) 
  { 
-    const int W = 800;
-    const int H = 600;
+    // Vue optionnelle : --center re im --zoom z --size W H --iter n, et
+    // fractale : --fractal mandelbrot|julia|ship --degree d --julia re im
+    // (voir DeepZoom.hpp)
+    ViewParameters view;
+    bool deep;
+    try {
+        view = parseViewParameters(argc, argv);
+        deep = installView(view);
+    } catch ( const std::exception& e ) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    const int W = view.W;
+    const int H = view.H;
     // Normalement, pour un bon rendu, il faudrait le nombre d'itérations
     // ci--dessous :
     //const int maxIter = 16777216;
-    const int maxIter = 8*65536;
-    auto iters = computeMandelbrotSet( W, H, maxIter );
-    savePicture("mandelbrot.tga", W, H, iters, maxIter);
+    const int maxIter = view.maxIter;
+    // Noyau de calcul optionnel : scalar, avx2 ou avx512 (par défaut le plus
+    // large supporté par le processeur)
+    if ( view.positional.size() > 0 ) setSimdKernel(simdKernelFromName(view.positional[0]));
+    std::cout << "Noyau de calcul : " << simdKernelName(getSimdKernel()) << std::endl;
+    // Algorithme optionnel : brute (défaut), mariani (Mariani-Silver) ou
+    // compare (les deux, en vérifiant qu'on obtient la même image).
+    // "cycles" mesure seulement l'apport de la détection de cycle,
+    // "precision" le débit de chaque précision sur la vue, "fractals"
+    // celui des noyaux génériques, "antialias" ajoute un anti-crénelage
+    // adaptatif,
+    // "animation" calcule une suite d'images de plus en plus zoomées.
+    std::string algo = ( view.positional.size() > 1 ? view.positional[1] : "brute" );
+    // Mariani-Silver calcule ses pixels par paquets en double : en zoom
+    // profond, seul le calcul ligne à ligne est disponible
+    if ( deep && algo != "brute" ) {
+        std::cout << "Zoom profond : algorithme " << algo << " remplacé par brute" << std::endl;
+        algo = "brute";
+    }
+    // Les ensembles de niveau du Burning Ship ne sont pas connexes : le
+    // remplissage de Mariani-Silver n'y est pas exact
+    if ( (getFractal().variant == burning_ship_fractal) && (algo == "mariani" || algo == "compare") ) {
+        std::cout << "Burning Ship : algorithme " << algo << " remplacé par brute" << std::endl;
+        algo = "brute";
+    }
+    if ( algo == "animation" ) {
+        // Animation de zoom : nombre d'images (32), facteur de zoom entre
+        // deux images (2), puis "noreuse" et/ou "serial" pour désactiver
+        // la reprise des pixels communs ou le pipeline
+        AnimationParameters params;
+        params.centerRe = std::strtod(view.centerRe.c_str(), nullptr);
+        params.centerIm = std::strtod(view.centerIm.c_str(), nullptr);
+        params.zoom     = view.zoom;
+        params.nbFrames = ( view.positional.size() > 2 ? std::atoi(view.positional[2].c_str()) : 32 );
+        params.factor   = ( view.positional.size() > 3 ? std::atof(view.positional[3].c_str()) : 2. );
+        params.W = W; params.H = H; params.maxIter = maxIter;
+        params.reuse = params.pipelined = true;
+        for ( std::size_t k = 4; k < view.positional.size(); ++k ) {
+            if ( view.positional[k] == "noreuse" ) params.reuse     = false;
+            if ( view.positional[k] == "serial"  ) params.pipelined = false;
+        }
+        params.prefix = "frame";
+        if ( params.zoom*std::pow(params.factor, params.nbFrames-1) > 1.E10 ) {
+            std::cerr << "Animation limitée aux zooms calculables en double (1e10)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        renderZoomAnimation(params);
+        return EXIT_SUCCESS;
+    }
+    if ( algo == "cycles" ) {
+        benchPeriodicity( W, H, maxIter );
+        return EXIT_SUCCESS;
+    }
+    if ( algo == "precision" ) {
+        benchPrecision( W, H, maxIter );
+        return EXIT_SUCCESS;
+    }
+    if ( algo == "fractals" ) {
+        benchFractals( W, H, maxIter );
+        return EXIT_SUCCESS;
+    }
+    // Anti-crénelage adaptatif sur l'image calculée par force brute :
+    // sous-échantillons par côté (4), seuil de détection des bords (32),
+    // puis "compare" pour calculer aussi le suréchantillonnage uniforme
+    if ( algo == "antialias" ) {
+        int n = ( view.positional.size() > 2 ? std::atoi(view.positional[2].c_str()) : 4 );
+        int threshold = ( view.positional.size() > 3 ? std::atoi(view.positional[3].c_str()) : 32 );
+        bool compare = ( view.positional.size() > 4 && view.positional[4] == "compare" );
+        auto iters = computeMandelbrotSet( W, H, maxIter );
+        renderAntiAliased( W, H, maxIter, iters, n, threshold, compare );
+        return EXIT_SUCCESS;
+    }
+    std::vector<int> iters;
+    if ( algo == "mariani" )
+        iters = computeMandelbrotSetMS( W, H, maxIter );
+    else
+        iters = computeMandelbrotSet( W, H, maxIter );
+    if ( algo == "compare" ) {
+        auto itersMS = computeMandelbrotSetMS( W, H, maxIter );
+        long nbDiffs = 0;
+        for ( int i = 0; i < W*H; ++i ) nbDiffs += ( iters[i] != itersMS[i] );
+        std::cout << "Pixels différents entre les deux algorithmes : " << nbDiffs << std::endl;
+    }
+    savePicture("mandelbrot.ppm", W, H, iters, maxIter);
     return EXIT_SUCCESS;
  }
     
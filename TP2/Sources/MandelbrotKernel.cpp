@@ -0,0 +1,781 @@
+# include <cmath>
+# include <limits>
+# include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+# define MANDELBROT_X86_SIMD
+# include <immintrin.h>
+#endif
+# include "DoubleDouble.hpp"
+# include "MandelbrotKernel.hpp"
+# include "EscapeKernels.hpp"
+
+/* Important : les noyaux vectoriels doivent donner exactement les mêmes
+ * nombres d'itérations que le noyau scalaire. Ils effectuent donc les
+ * mêmes opérations flottantes, dans le même ordre, et le Makefile compile
+ * ce fichier avec -ffp-contract=off pour que le compilateur ne fusionne
+ * pas certains produits et sommes en FMA d'un côté et pas de l'autre.
+ * -fno-trapping-math (qui ne change aucun résultat) permet au compilateur
+ * d'évaluer les comparaisons de toutes les voies sans branchement, donc
+ * de vectoriser le noyau générique.
+ */
+namespace {
+    simd_kernel s_kernel = automatic;
+    precision s_precision = double_precision;
+    bool s_periodicity = true;
+    // Fenêtre du plan complexe représentée par l'image
+    double s_xmin = -2., s_xmax = 1., s_ymin = -1.125, s_ymax = 1.125;
+    RowRenderer s_rowRenderer;
+    Fractal s_fractal = { mandelbrot_fractal, 2, 0., 0. };
+    /* Détection de cycle (méthode de Brent) : on sauve z aux itérations
+     * 1, 2, 4, 8, ... et on compare chaque nouvel itéré au dernier z sauvé.
+     * Si l'orbite retombe exactement sur ce point, elle est sur un cycle :
+     * c est intérieur, le résultat est maxIter. Entre les sauvegardes 2^k et
+     * 2^(k+1), on détecte tous les cycles de période inférieure ou égale à
+     * 2^k. Pas de tolérance : l'itération étant déterministe, une orbite
+     * cyclique retombe bit à bit sur le point sauvé, alors qu'une orbite qui
+     * s'échappe lentement (près de c = 1/4) avance par pas plus petits que
+     * toute tolérance fixe.
+     */
+    // -----------------------------------------------------------------
+    /* Boucle d'échappement proprement dite, sans les tests de zones de
+     * convergence connues
+     */
+    int escapeTime( int maxIter, const Complex& c )
+    {
+        Complex z{0.,0.};
+        Complex zsave{0.,0.};
+        long checkpoint = 1;
+        int niter = 0;
+        while ((z.sqNorm() < 4.) && (niter < maxIter))
+        {
+            z = z*z + c;
+            ++niter;
+            if ( s_periodicity ) {
+                if ( (z.real == zsave.real) && (z.imag == zsave.imag) ) return maxIter;
+                if ( niter == checkpoint ) {
+                    zsave = z;
+                    checkpoint *= 2;
+                }
+            }
+        }
+        return niter;
+    }
+    // -----------------------------------------------------------------
+    void iterPointsScalar( int maxIter, const std::vector<int>& todo,
+                           const double* cre, const double* cim, int* nbIters )
+    {
+        for ( int ind : todo )
+            nbIters[ind] = escapeTime(maxIter, Complex{cre[ind],cim[ind]});
+    }
+    /* Opérations sur les réels pour les noyaux génériques et EscapeStep ;
+     * same : égalité exacte, pour la détection de cycle (l'itération est
+     * déterministe, un z retombé exactement sur le point sauvé boucle) */
+    template<typename Real> struct RealTraits;
+    template<> struct RealTraits<float>
+    {
+        static float zero() { return 0.f; }
+        static float nan()  { return std::numeric_limits<float>::quiet_NaN(); }
+        static float sqr( float x ) { return x*x; }
+        static float twice( float x ) { return x+x; }
+        static float abs( float x ) { return std::abs(x); }
+        static bool escaped( float x2, float y2 ) { return x2 + y2 >= 4.f; }
+        static bool same( float x, float y ) { return x == y; }
+    };
+    template<> struct RealTraits<double>
+    {
+        static double zero() { return 0.; }
+        static double nan()  { return std::numeric_limits<double>::quiet_NaN(); }
+        static double sqr( double x ) { return x*x; }
+        static double twice( double x ) { return x+x; }
+        static double abs( double x ) { return std::abs(x); }
+        static bool escaped( double x2, double y2 ) { return x2 + y2 >= 4.; }
+        static bool same( double x, double y ) { return x == y; }
+    };
+    template<> struct RealTraits<DoubleDouble>
+    {
+        static DoubleDouble zero() { return DoubleDouble{0., 0.}; }
+        static DoubleDouble nan()  { return ddFromDouble(std::numeric_limits<double>::quiet_NaN()); }
+        static DoubleDouble sqr( DoubleDouble x ) { return ddSqr(x); }
+        static DoubleDouble twice( DoubleDouble x ) { return ddTwice(x); }
+        static DoubleDouble abs( DoubleDouble x ) { return ( x.hi < 0. ? -x : x ); }
+        // La partie haute suffit pour comparer à 4
+        static bool escaped( DoubleDouble x2, DoubleDouble y2 ) { return x2.hi + y2.hi >= 4.; }
+        static bool same( DoubleDouble x, DoubleDouble y ) { return (x.hi == y.hi) & (x.lo == y.lo); }
+    };
+
+#if defined(MANDELBROT_X86_SIMD)
+    /* Noyaux vectoriels : chaque voie (lane) du registre itère un pixel
+     * différent. Dès qu'une voie a divergé ou atteint maxIter, on range son
+     * résultat et on la recharge avec le prochain pixel à calculer : les
+     * voies ne restent pas inoccupées à attendre le pixel le plus long.
+     * Quand il n'y a plus de pixel, la voie est neutralisée (c = z = 0 et
+     * un compteur très négatif qui n'atteindra jamais maxIter). Son point
+     * sauvé pour la détection de cycle vaut NaN : toute comparaison avec
+     * lui est fausse, une voie neutralisée n'est donc jamais un "cycle".
+     * La détection de cycle est la même que dans escapeTime.
+     *
+     * L'itération est celle d'EscapeStep<V, d> (EscapeKernels.hpp), sur
+     * les registres entiers grâce aux opérateurs vectoriels de g++ :
+     * l'instance <mandelbrot_fractal, 2> est le noyau z*z + c historique,
+     * aux mêmes opérations près. Le point de départ de chaque voie est
+     * donné par la même étape en double. (Les types __m256d et __m512d
+     * portent des attributs perdus en argument de modèle : l'étape
+     * travaille sur des vecteurs équivalents, Double4 et Double8.)
+     */
+    const double inactiveIter = -1.E300;
+    const double inactiveSave = std::numeric_limits<double>::quiet_NaN();
+
+    typedef double Double4 __attribute__((vector_size(32)));
+    typedef double Double8 __attribute__((vector_size(64)));
+    struct Avx2Traits
+    {
+        __attribute__((target("avx2"))) static Double4 sqr( Double4 x ) { return x*x; }
+        __attribute__((target("avx2"))) static Double4 twice( Double4 x ) { return x+x; }
+        __attribute__((target("avx2"))) static Double4 abs( Double4 x )
+        { return _mm256_andnot_pd(_mm256_set1_pd(-0.), x); }
+    };
+    struct Avx512Traits
+    {
+        __attribute__((target("avx512f"))) static Double8 sqr( Double8 x ) { return x*x; }
+        __attribute__((target("avx512f"))) static Double8 twice( Double8 x ) { return x+x; }
+        __attribute__((target("avx512f"))) static Double8 abs( Double8 x ) { return _mm512_abs_pd(x); }
+    };
+    // -----------------------------------------------------------------
+    template<fractal_variant V, int d>
+    __attribute__((target("avx2")))
+    void iterPointsAVX2( int maxIter, const std::vector<int>& todo,
+                         const double* cre, const double* cim, int* nbIters,
+                         bool periodicity, double jr, double ji )
+    {
+        const EscapeStep<V, d, double, RealTraits<double>> start{jr, ji};
+        const EscapeStep<V, d, Double4, Avx2Traits> step{};
+        const int nbLanes = 4;
+        alignas(32) double zr[nbLanes], zi[nbLanes], cr[nbLanes], ci[nbLanes], it[nbLanes];
+        alignas(32) double sr[nbLanes], si[nbLanes], ck[nbLanes];
+        int idx[nbLanes];
+        std::size_t next = 0;
+        int nbActive = 0;
+        // (Re)charge la voie l avec le prochain pixel, ou la neutralise
+        auto refill = [&] ( int l ) {
+            ck[l] = 1.;
+            if ( next < todo.size() ) {
+                idx[l] = todo[next++];
+                start.start(cre[idx[l]], cim[idx[l]], zr[l], zi[l], cr[l], ci[l]);
+                sr[l] = zr[l]; si[l] = zi[l]; it[l] = 0.;
+                return 1;
+            }
+            zr[l] = 0.; zi[l] = 0.; cr[l] = 0.; ci[l] = 0.; it[l] = inactiveIter;
+            sr[l] = inactiveSave; si[l] = inactiveSave;
+            return 0;
+        };
+        for ( int l = 0; l < nbLanes; ++l ) nbActive += refill(l);
+        __m256d vzr = _mm256_load_pd(zr), vzi = _mm256_load_pd(zi);
+        __m256d vcr = _mm256_load_pd(cr), vci = _mm256_load_pd(ci);
+        __m256d vit = _mm256_load_pd(it);
+        __m256d vsr = _mm256_load_pd(sr), vsi = _mm256_load_pd(si);
+        __m256d vck = _mm256_load_pd(ck);
+        const __m256d four = _mm256_set1_pd(4.);
+        const __m256d vmax = _mm256_set1_pd(double(maxIter));
+        const __m256d one  = _mm256_set1_pd(1.);
+        while ( nbActive > 0 ) {
+            __m256d zr2 = _mm256_mul_pd(vzr, vzr);
+            __m256d zi2 = _mm256_mul_pd(vzi, vzi);
+            __m256d sq  = _mm256_add_pd(zr2, zi2);
+            __m256d done = _mm256_or_pd(_mm256_cmp_pd(sq, four, _CMP_GE_OQ),
+                                        _mm256_cmp_pd(vit, vmax, _CMP_GE_OQ));
+            int mask = _mm256_movemask_pd(done);
+            if ( mask != 0 ) {
+                // Au moins un pixel terminé : on range et on recharge les voies
+                _mm256_store_pd(zr, vzr); _mm256_store_pd(zi, vzi);
+                _mm256_store_pd(cr, vcr); _mm256_store_pd(ci, vci);
+                _mm256_store_pd(it, vit);
+                _mm256_store_pd(sr, vsr); _mm256_store_pd(si, vsi);
+                _mm256_store_pd(ck, vck);
+                for ( int l = 0; l < nbLanes; ++l ) {
+                    if ( (mask & (1<<l)) == 0 ) continue;
+                    nbIters[idx[l]] = int(it[l]);
+                    if ( !refill(l) ) --nbActive;
+                }
+                vzr = _mm256_load_pd(zr); vzi = _mm256_load_pd(zi);
+                vcr = _mm256_load_pd(cr); vci = _mm256_load_pd(ci);
+                vit = _mm256_load_pd(it);
+                vsr = _mm256_load_pd(sr); vsi = _mm256_load_pd(si);
+                vck = _mm256_load_pd(ck);
+                continue; // Les nouvelles voies doivent être testées avant d'itérer
+            }
+            // z = f(z) + c (pour z*z + c, les opérations et l'ordre de Complex)
+            Double4 nzr, nzi;
+            step.next(vzr, vzi, zr2, zi2, vcr, vci, nzr, nzi);
+            vzr = nzr; vzi = nzi;
+            vit = _mm256_add_pd(vit, one);
+            if ( periodicity ) {
+                // Égalité exacte ; le point sauvé NaN des voies inactives ne l'est jamais
+                __m256d cycle = _mm256_and_pd(_mm256_cmp_pd(vzr, vsr, _CMP_EQ_OQ),
+                                              _mm256_cmp_pd(vzi, vsi, _CMP_EQ_OQ));
+                // Un cycle : le compteur passe à maxIter, la voie sera rangée au prochain tour
+                vit = _mm256_blendv_pd(vit, vmax, cycle);
+                __m256d save = _mm256_cmp_pd(vit, vck, _CMP_EQ_OQ);
+                vsr = _mm256_blendv_pd(vsr, vzr, save);
+                vsi = _mm256_blendv_pd(vsi, vzi, save);
+                vck = _mm256_blendv_pd(vck, _mm256_add_pd(vck, vck), save);
+            }
+        }
+    }
+    // -----------------------------------------------------------------
+    template<fractal_variant V, int d>
+    __attribute__((target("avx512f")))
+    void iterPointsAVX512( int maxIter, const std::vector<int>& todo,
+                           const double* cre, const double* cim, int* nbIters,
+                           bool periodicity, double jr, double ji )
+    {
+        const EscapeStep<V, d, double, RealTraits<double>> start{jr, ji};
+        const EscapeStep<V, d, Double8, Avx512Traits> step{};
+        const int nbLanes = 8;
+        alignas(64) double zr[nbLanes], zi[nbLanes], cr[nbLanes], ci[nbLanes], it[nbLanes];
+        alignas(64) double sr[nbLanes], si[nbLanes], ck[nbLanes];
+        int idx[nbLanes];
+        std::size_t next = 0;
+        int nbActive = 0;
+        // (Re)charge la voie l avec le prochain pixel, ou la neutralise
+        auto refill = [&] ( int l ) {
+            ck[l] = 1.;
+            if ( next < todo.size() ) {
+                idx[l] = todo[next++];
+                start.start(cre[idx[l]], cim[idx[l]], zr[l], zi[l], cr[l], ci[l]);
+                sr[l] = zr[l]; si[l] = zi[l]; it[l] = 0.;
+                return 1;
+            }
+            zr[l] = 0.; zi[l] = 0.; cr[l] = 0.; ci[l] = 0.; it[l] = inactiveIter;
+            sr[l] = inactiveSave; si[l] = inactiveSave;
+            return 0;
+        };
+        for ( int l = 0; l < nbLanes; ++l ) nbActive += refill(l);
+        __m512d vzr = _mm512_load_pd(zr), vzi = _mm512_load_pd(zi);
+        __m512d vcr = _mm512_load_pd(cr), vci = _mm512_load_pd(ci);
+        __m512d vit = _mm512_load_pd(it);
+        __m512d vsr = _mm512_load_pd(sr), vsi = _mm512_load_pd(si);
+        __m512d vck = _mm512_load_pd(ck);
+        const __m512d four = _mm512_set1_pd(4.);
+        const __m512d vmax = _mm512_set1_pd(double(maxIter));
+        const __m512d one  = _mm512_set1_pd(1.);
+        while ( nbActive > 0 ) {
+            __m512d zr2 = _mm512_mul_pd(vzr, vzr);
+            __m512d zi2 = _mm512_mul_pd(vzi, vzi);
+            __m512d sq  = _mm512_add_pd(zr2, zi2);
+            __mmask8 mask = _mm512_kor(_mm512_cmp_pd_mask(sq, four, _CMP_GE_OQ),
+                                       _mm512_cmp_pd_mask(vit, vmax, _CMP_GE_OQ));
+            if ( mask != 0 ) {
+                _mm512_store_pd(zr, vzr); _mm512_store_pd(zi, vzi);
+                _mm512_store_pd(cr, vcr); _mm512_store_pd(ci, vci);
+                _mm512_store_pd(it, vit);
+                _mm512_store_pd(sr, vsr); _mm512_store_pd(si, vsi);
+                _mm512_store_pd(ck, vck);
+                for ( int l = 0; l < nbLanes; ++l ) {
+                    if ( (mask & (1<<l)) == 0 ) continue;
+                    nbIters[idx[l]] = int(it[l]);
+                    if ( !refill(l) ) --nbActive;
+                }
+                vzr = _mm512_load_pd(zr); vzi = _mm512_load_pd(zi);
+                vcr = _mm512_load_pd(cr); vci = _mm512_load_pd(ci);
+                vit = _mm512_load_pd(it);
+                vsr = _mm512_load_pd(sr); vsi = _mm512_load_pd(si);
+                vck = _mm512_load_pd(ck);
+                continue;
+            }
+            Double8 nzr, nzi;
+            step.next(vzr, vzi, zr2, zi2, vcr, vci, nzr, nzi);
+            vzr = nzr; vzi = nzi;
+            vit = _mm512_add_pd(vit, one);
+            if ( periodicity ) {
+                __mmask8 cycle = _mm512_kand(_mm512_cmp_pd_mask(vzr, vsr, _CMP_EQ_OQ),
+                                             _mm512_cmp_pd_mask(vzi, vsi, _CMP_EQ_OQ));
+                vit = _mm512_mask_blend_pd(cycle, vit, vmax);
+                __mmask8 save = _mm512_cmp_pd_mask(vit, vck, _CMP_EQ_OQ);
+                vsr = _mm512_mask_blend_pd(save, vsr, vzr);
+                vsi = _mm512_mask_blend_pd(save, vsi, vzi);
+                vck = _mm512_mask_blend_pd(save, vck, _mm512_add_pd(vck, vck));
+            }
+        }
+    }
+#endif
+    // -----------------------------------------------------------------
+    simd_kernel detectSimdKernel()
+    {
+#if defined(MANDELBROT_X86_SIMD)
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("avx512f") ) return avx512;
+        if ( __builtin_cpu_supports("avx2") ) return avx2;
+#endif
+        return scalar;
+    }
+    // -----------------------------------------------------------------
+    /* Noyau générique, paramétré par le type des réels (float, double ou
+     * DoubleDouble) et le nombre N de voies. Même principe que les noyaux
+     * vectoriels ci-dessus (voies rechargées dès qu'un pixel est terminé,
+     * détection de cycle de Brent), mais écrit pour N voies en C++ simple :
+     * les boucles sur les voies sont de longueur fixe et sans branchement,
+     * le compilateur les vectorise pour le jeu d'instructions de la cible
+     * (-march=native). Les tableaux de DoubleDouble sont rangés en
+     * structure de tableaux (hi[N], lo[N]) pour que leurs deux moitiés se
+     * chargent dans des registres séparés.
+     */
+    template<typename Real, int N>
+    struct LaneArray
+    {
+        Real v[N];
+        Real get( int l ) const { return v[l]; }
+        void set( int l, Real x ) { v[l] = x; }
+    };
+    template<int N>
+    struct LaneArray<DoubleDouble, N>
+    {
+        double hi[N], lo[N];
+        DoubleDouble get( int l ) const { return DoubleDouble{hi[l], lo[l]}; }
+        void set( int l, DoubleDouble x ) { hi[l] = x.hi; lo[l] = x.lo; }
+    };
+
+    /* load(k, a, b) donne le point d'indice k, step l'itération (voir
+     * EscapeKernels.hpp). La détection de cycle est un paramètre du
+     * modèle : pas de test dans la boucle sur les voies */
+    template<typename Real, int N, bool periodicity, typename Step, typename Loader>
+    void iterPointsLanes( int maxIter, const std::vector<int>& todo, const Step& step, Loader load,
+                          int* nbIters )
+    {
+        typedef RealTraits<Real> T;
+        LaneArray<Real,N> zr, zi, cr, ci, sr, si;
+        int it[N], ck[N], live[N], idx[N], done[N];
+        std::size_t next = 0;
+        int nbActive = 0;
+        // (Re)charge la voie l avec le prochain point, ou la neutralise
+        auto refill = [&] ( int l ) {
+            it[l] = 0; ck[l] = 1;
+            if ( next < todo.size() ) {
+                idx[l] = todo[next++];
+                Real a, b, z0r, z0i, c0r, c0i;
+                load(idx[l], a, b);
+                step.start(a, b, z0r, z0i, c0r, c0i);
+                zr.set(l, z0r); zi.set(l, z0i);
+                cr.set(l, c0r); ci.set(l, c0i);
+                sr.set(l, z0r); si.set(l, z0i);
+                live[l] = 1;
+            } else {
+                zr.set(l, T::zero()); zi.set(l, T::zero());
+                cr.set(l, T::zero()); ci.set(l, T::zero());
+                sr.set(l, T::nan()); si.set(l, T::nan());
+                live[l] = 0;
+            }
+            return live[l];
+        };
+        for ( int l = 0; l < N; ++l ) nbActive += refill(l);
+        while ( nbActive > 0 ) {
+            int anyDone = 0;
+            for ( int l = 0; l < N; ++l ) {
+                Real a = zr.get(l), b = zi.get(l);
+                Real a2 = T::sqr(a), b2 = T::sqr(b);
+                int d = live[l] & ( T::escaped(a2, b2) | (it[l] >= maxIter) );
+                done[l] = d;
+                anyDone |= d;
+                // z = f(z) + c, sauf pour les voies terminées (figées)
+                Real nzr, nzi;
+                step.next(a, b, a2, b2, cr.get(l), ci.get(l), nzr, nzi);
+                zr.set(l, d ? a : nzr);
+                zi.set(l, d ? b : nzi);
+                int count = it[l] + (live[l] & (1-d));
+                if ( periodicity ) {
+                    Real s = sr.get(l), t = si.get(l);
+                    int cycle = (1-d) & T::same(nzr, s) & T::same(nzi, t);
+                    count = cycle ? maxIter : count;
+                    int save = (1-d) & (count == ck[l]);
+                    sr.set(l, save ? nzr : s);
+                    si.set(l, save ? nzi : t);
+                    ck[l] = save ? 2*ck[l] : ck[l];
+                }
+                it[l] = count;
+            }
+            if ( anyDone ) {
+                for ( int l = 0; l < N; ++l ) {
+                    if ( !done[l] ) continue;
+                    nbIters[idx[l]] = it[l];
+                    if ( !refill(l) ) --nbActive;
+                }
+            }
+        }
+    }
+
+    /* Nombre de voies du noyau générique selon le noyau vectoriel choisi */
+    template<typename Real, bool periodicity, typename Step, typename Loader>
+    void iterPointsWidth( int maxIter, const std::vector<int>& todo, const Step& step, Loader load,
+                          int* nbIters )
+    {
+        const int nbBytes = ( getSimdKernel() == avx512 ? 64 : ( getSimdKernel() == avx2 ? 32 : 0 ) );
+        const int nbLanes = nbBytes/int(sizeof(Real) < 8 ? sizeof(Real) : 8);
+        if ( nbLanes >= 16 )
+            iterPointsLanes<Real,16,periodicity>(maxIter, todo, step, load, nbIters);
+        else if ( nbLanes == 8 )
+            iterPointsLanes<Real,8,periodicity>(maxIter, todo, step, load, nbIters);
+        else if ( nbLanes == 4 )
+            iterPointsLanes<Real,4,periodicity>(maxIter, todo, step, load, nbIters);
+        else
+            iterPointsLanes<Real,1,periodicity>(maxIter, todo, step, load, nbIters);
+    }
+
+    template<typename Real, typename Step, typename Loader>
+    void iterPointsGeneric( int maxIter, const std::vector<int>& todo, const Step& step, Loader load,
+                            int* nbIters, bool periodicity )
+    {
+        if ( periodicity ) iterPointsWidth<Real,true >(maxIter, todo, step, load, nbIters);
+        else               iterPointsWidth<Real,false>(maxIter, todo, step, load, nbIters);
+    }
+
+    /* Itération quadratique z*z + c, celle des noyaux écrits à la main */
+    template<typename Real>
+    EscapeStep<mandelbrot_fractal, 2, Real, RealTraits<Real>> quadraticStep()
+    {
+        return EscapeStep<mandelbrot_fractal, 2, Real, RealTraits<Real>>{ RealTraits<Real>::zero(),
+                                                                         RealTraits<Real>::zero() };
+    }
+
+    /* Instance (V, d) : noyau vectoriel écrit pour les doubles s'il est
+     * disponible, noyau générique sinon */
+    template<fractal_variant V, int d>
+    void iterPointsDegree( const Fractal& fractal, int maxIter, const std::vector<int>& todo,
+                           const double* cre, const double* cim, int* nbIters )
+    {
+        const double jr = fractal.juliaRe, ji = fractal.juliaIm;
+        if ( s_precision == single_precision ) {
+            iterPointsGeneric<float>(maxIter, todo,
+                                     EscapeStep<V,d,float,RealTraits<float>>{float(jr), float(ji)},
+                                     [cre, cim] ( int k, float& a, float& b ) {
+                                         a = float(cre[k]); b = float(cim[k]);
+                                     }, nbIters, s_periodicity);
+            return;
+        }
+        switch(getSimdKernel()) {
+#if defined(MANDELBROT_X86_SIMD)
+        case avx512 :
+            iterPointsAVX512<V,d>(maxIter, todo, cre, cim, nbIters, s_periodicity, jr, ji);
+            break;
+        case avx2 :
+            iterPointsAVX2<V,d>(maxIter, todo, cre, cim, nbIters, s_periodicity, jr, ji);
+            break;
+#endif
+        default :
+            iterPointsGeneric<double>(maxIter, todo, EscapeStep<V,d,double,RealTraits<double>>{jr, ji},
+                                      [cre, cim] ( int k, double& a, double& b ) {
+                                          a = cre[k]; b = cim[k];
+                                      }, nbIters, s_periodicity);
+        }
+    }
+
+    /* Le degré, connu seulement à l'exécution, choisit l'instance du noyau */
+    template<fractal_variant V>
+    void iterPointsVariant( const Fractal& fractal, int maxIter, const std::vector<int>& todo,
+                            const double* cre, const double* cim, int* nbIters )
+    {
+        switch(fractal.degree) {
+        case 3 : iterPointsDegree<V,3>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        case 4 : iterPointsDegree<V,4>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        case 5 : iterPointsDegree<V,5>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        case 6 : iterPointsDegree<V,6>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        case 7 : iterPointsDegree<V,7>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        case 8 : iterPointsDegree<V,8>(fractal, maxIter, todo, cre, cim, nbIters); break;
+        default: iterPointsDegree<V,2>(fractal, maxIter, todo, cre, cim, nbIters);
+        }
+    }
+}
+// =====================================================================
+std::ostream& operator << ( std::ostream& out, const Complex& c )
+{
+  out << "(" << c.real << "," << c.imag << ")" << std::endl;
+  return out;
+}
+// ---------------------------------------------------------------------
+bool
+isInKnownConvergenceZone( const Complex& c )
+{
+    // Appartenance aux disques  C0{(0,0),1/4} et C1{(-1,0),1/4}
+    if ( c.real*c.real+c.imag*c.imag < 0.0625 )
+        return true;
+    if ( (c.real+1)*(c.real+1)+c.imag*c.imag < 0.0625 )
+        return true;
+    // Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))}
+    if ((c.real > -0.75) && (c.real < 0.5) ) {
+        Complex ct{c.real-0.25,c.imag};
+        double ctnrm2 = sqrt(ct.sqNorm());
+        if (ctnrm2 < 0.5*(1-ct.real/ctnrm2)) return true;
+    }
+    // Les autres bulbes ne sont pas des disques : on teste des disques
+    // inscrits, obtenus en calculant numériquement le bord de chaque bulbe
+    // (multiplicateur du cycle de module 1) puis réduits d'environ 2%.
+    // Bulbes de période 3 en -0.125 +/- 0.7449i (rayon inscrit 0.0935)
+    double ai = std::abs(c.imag);
+    if ( (c.real+0.125)*(c.real+0.125)+(ai-0.744862)*(ai-0.744862) < 0.0915*0.0915 )
+        return true;
+    // Bulbes de période 4 en 0.2811 +/- 0.5312i (rayon inscrit 0.0438)
+    if ( (c.real-0.28113)*(c.real-0.28113)+(ai-0.53120)*(ai-0.53120) < 0.0425*0.0425 )
+        return true;
+    // Bulbe de période 4 en -1.3092 sur l'axe réel (rayon inscrit 0.0589)
+    if ( (c.real+1.30919)*(c.real+1.30919)+c.imag*c.imag < 0.0575*0.0575 )
+        return true;
+    // Cardioïde de période 3 en -1.7593 sur l'axe réel (rayon inscrit 0.0092)
+    if ( (c.real+1.75931)*(c.real+1.75931)+c.imag*c.imag < 0.0090*0.0090 )
+        return true;
+    return false;
+}
+// ---------------------------------------------------------------------
+int iterMandelbrot( int maxIter, const Complex& c)
+{
+    // On vérifie dans un premier temps si le complexe
+    // n'appartient pas à une zone de convergence connue :
+    if ( isInKnownConvergenceZone(c) )
+        return maxIter;
+    return escapeTime(maxIter, c);
+}
+// ---------------------------------------------------------------------
+void
+setSimdKernel( simd_kernel kernel )
+{
+    s_kernel = kernel;
+}
+// ---------------------------------------------------------------------
+void
+setPeriodicityCheck( bool check )
+{
+    s_periodicity = check;
+}
+// ---------------------------------------------------------------------
+simd_kernel
+getSimdKernel()
+{
+    // Un noyau demandé mais non supporté par le processeur est remplacé
+    // par le plus large disponible
+    simd_kernel best = detectSimdKernel();
+    if ( (s_kernel == automatic) || (s_kernel > best) ) return best;
+    return s_kernel;
+}
+// ---------------------------------------------------------------------
+const char*
+simdKernelName( simd_kernel kernel )
+{
+    switch(kernel) {
+    case scalar : return "scalar";
+    case avx2   : return "avx2";
+    case avx512 : return "avx512";
+    default     : return "automatic";
+    }
+}
+// ---------------------------------------------------------------------
+simd_kernel
+simdKernelFromName( const std::string& name )
+{
+    if ( name == "scalar" ) return scalar;
+    if ( name == "avx2"   ) return avx2;
+    if ( name == "avx512" ) return avx512;
+    return automatic;
+}
+// ---------------------------------------------------------------------
+void
+iterMandelbrotPoints( int maxIter, int n, const double* cre, const double* cim, int* nbIters )
+{
+    if ( !isQuadraticMandelbrot(s_fractal) ) {
+        iterEscapePoints(s_fractal, maxIter, n, cre, cim, nbIters);
+        return;
+    }
+    // Les points des zones de convergence connues ne passent pas dans les
+    // noyaux : on ne garde que les indices des points à itérer
+    std::vector<int> todo;
+    todo.reserve(n);
+    for ( int k = 0; k < n; ++k ) {
+        if ( isInKnownConvergenceZone(Complex{cre[k],cim[k]}) )
+            nbIters[k] = maxIter;
+        else
+            todo.push_back(k);
+    }
+    if ( s_precision == single_precision ) {
+        iterPointsGeneric<float>(maxIter, todo, quadraticStep<float>(),
+                                 [cre, cim] ( int k, float& a, float& b ) {
+                                     a = float(cre[k]); b = float(cim[k]);
+                                 }, nbIters, s_periodicity);
+        return;
+    }
+    switch(getSimdKernel()) {
+#if defined(MANDELBROT_X86_SIMD)
+    case avx512 :
+        iterPointsAVX512<mandelbrot_fractal,2>(maxIter, todo, cre, cim, nbIters, s_periodicity, 0., 0.);
+        break;
+    case avx2 :
+        iterPointsAVX2<mandelbrot_fractal,2>(maxIter, todo, cre, cim, nbIters, s_periodicity, 0., 0.);
+        break;
+#endif
+    default :
+        iterPointsScalar(maxIter, todo, cre, cim, nbIters);
+    }
+}
+// ---------------------------------------------------------------------
+void
+iterEscapePoints( const Fractal& fractal, int maxIter, int n, const double* cre, const double* cim,
+                  int* nbIters )
+{
+    // Les zones de convergence connues ne valent que pour z*z + c
+    bool filter = isQuadraticMandelbrot(fractal);
+    std::vector<int> todo;
+    todo.reserve(n);
+    for ( int k = 0; k < n; ++k ) {
+        if ( filter && isInKnownConvergenceZone(Complex{cre[k],cim[k]}) )
+            nbIters[k] = maxIter;
+        else
+            todo.push_back(k);
+    }
+    switch(fractal.variant) {
+    case julia_fractal :
+        iterPointsVariant<julia_fractal>(fractal, maxIter, todo, cre, cim, nbIters);
+        break;
+    case burning_ship_fractal :
+        iterPointsVariant<burning_ship_fractal>(fractal, maxIter, todo, cre, cim, nbIters);
+        break;
+    default :
+        iterPointsVariant<mandelbrot_fractal>(fractal, maxIter, todo, cre, cim, nbIters);
+    }
+}
+// ---------------------------------------------------------------------
+void
+setFractal( const Fractal& fractal )
+{
+    s_fractal = fractal;
+}
+// ---------------------------------------------------------------------
+Fractal
+getFractal()
+{
+    return s_fractal;
+}
+// ---------------------------------------------------------------------
+bool
+isQuadraticMandelbrot( const Fractal& fractal )
+{
+    return (fractal.variant == mandelbrot_fractal) && (fractal.degree == 2);
+}
+// ---------------------------------------------------------------------
+const char*
+fractalVariantName( fractal_variant variant )
+{
+    switch(variant) {
+    case julia_fractal        : return "julia";
+    case burning_ship_fractal : return "ship";
+    default                   : return "mandelbrot";
+    }
+}
+// ---------------------------------------------------------------------
+void
+iterMandelbrotPointsDD( int maxIter, int n, const double* creHi, const double* creLo,
+                        const double* cimHi, const double* cimLo, int* nbIters )
+{
+    std::vector<int> todo;
+    todo.reserve(n);
+    for ( int k = 0; k < n; ++k ) {
+        if ( isInKnownConvergenceZone(Complex{creHi[k],cimHi[k]}) )
+            nbIters[k] = maxIter;
+        else
+            todo.push_back(k);
+    }
+    iterPointsGeneric<DoubleDouble>(maxIter, todo, quadraticStep<DoubleDouble>(),
+                                    [=] ( int k, DoubleDouble& a, DoubleDouble& b ) {
+                                        a = DoubleDouble{creHi[k], creLo[k]};
+                                        b = DoubleDouble{cimHi[k], cimLo[k]};
+                                    }, nbIters, s_periodicity);
+}
+// ---------------------------------------------------------------------
+void
+setPrecision( precision prec )
+{
+    // Le double-double ne passe pas par iterMandelbrotPoints (voir
+    // iterMandelbrotPointsDD) : on garde alors le double
+    s_precision = ( prec == single_precision ? single_precision : double_precision );
+}
+// ---------------------------------------------------------------------
+precision
+getPrecision()
+{
+    return s_precision;
+}
+// ---------------------------------------------------------------------
+const char*
+precisionName( precision prec )
+{
+    switch(prec) {
+    case single_precision : return "float";
+    case double_double    : return "dd";
+    default               : return "double";
+    }
+}
+// ---------------------------------------------------------------------
+precision
+selectPrecision( double magnitude, double spacing )
+{
+    if ( precisionResolves(single_precision, magnitude, spacing) ) return single_precision;
+    if ( precisionResolves(double_precision, magnitude, spacing) ) return double_precision;
+    return double_double;
+}
+// ---------------------------------------------------------------------
+bool
+precisionResolves( precision prec, double magnitude, double spacing )
+{
+    // Un pixel doit valoir au moins 2^10 ulp des coordonnées de c : les
+    // erreurs d'arrondi, amplifiées au fil des itérations, restent alors
+    // petites devant l'écart entre deux pixels voisins
+    const double margin = 1024.;
+    const double ddEpsilon = std::ldexp(1., -104);
+    double eps = ( prec == single_precision ? std::numeric_limits<float>::epsilon() :
+                   ( prec == double_precision ? std::numeric_limits<double>::epsilon() : ddEpsilon ) );
+    return spacing > margin*magnitude*eps;
+}
+// ---------------------------------------------------------------------
+Complex
+pixelToComplex( int W, int H, int num_ligne, int num_colonne )
+{
+    // Calcul le facteur d'échelle (par défaut, pour rester dans le disque
+    // de rayon 2 centré en (0,0))
+    double scaleX = (s_xmax-s_xmin)/(W-1);
+    double scaleY = (s_ymax-s_ymin)/(H-1.);
+    return Complex{s_xmin+num_colonne*scaleX,s_ymin+ num_ligne*scaleY};
+}
+// ---------------------------------------------------------------------
+void
+setViewport( double xmin, double xmax, double ymin, double ymax )
+{
+    s_xmin = xmin; s_xmax = xmax;
+    s_ymin = ymin; s_ymax = ymax;
+}
+// ---------------------------------------------------------------------
+void
+setRowRenderer( const RowRenderer& renderer )
+{
+    s_rowRenderer = renderer;
+}
+// ---------------------------------------------------------------------
+/**
+ * On parcourt chaque pixel de l'espace image et on fait correspondre par
+ * translation et homothétie une valeur complexe c qui servira pour
+ * itérer sur la suite de Mandelbrot. Le nombre d'itérations renvoyé
+ * servira pour construire l'image finale.
+
+ Sortie : un vecteur de taille W*H avec pour chaque case un nombre d'étape de convergence de 0 à maxIter
+ MODIFICATION DE LA FONCTION :
+ j'ai supprimé le paramètre W étant donné que maintenant, cette fonction ne prendra plus que des lignes de taille W en argument.
+ **/
+void
+computeMandelbrotSetRow( int W, int H, int maxIter, int num_ligne, int* pixels)
+{
+    if ( s_rowRenderer ) {
+        s_rowRenderer(W, H, maxIter, num_ligne, pixels);
+        return;
+    }
+    // On parcourt les pixels de l'espace image :
+    std::vector<double> cre(W), cim(W);
+    for ( int j = 0; j < W; ++j ) {
+        Complex c = pixelToComplex(W, H, num_ligne, j);
+        cre[j] = c.real;
+        cim[j] = c.imag;
+    }
+    iterMandelbrotPoints(maxIter, W, cre.data(), cim.data(), pixels);
+}
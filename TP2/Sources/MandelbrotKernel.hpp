@@ -0,0 +1,152 @@
+#ifndef _MANDELBROT_KERNEL_HPP_
+# define _MANDELBROT_KERNEL_HPP_
+# include <functional>
+# include <iostream>
+# include <string>
+
+/** Une structure complexe est définie pour la bonne raison que la classe
+ * complex proposée par g++ est très lente ! Le calcul est bien plus rapide
+ * avec la petite structure donnée ci--dessous
+ **/
+struct Complex
+{
+    Complex() : real(0.), imag(0.)
+    {}
+    Complex(double r, double i) : real(r), imag(i)
+    {}
+    Complex operator + ( const Complex& z )
+    {
+        return Complex(real + z.real, imag + z.imag );
+    }
+    Complex operator * ( const Complex& z )
+    {
+        return Complex(real*z.real-imag*z.imag, real*z.imag+imag*z.real);
+    }
+    double sqNorm() { return real*real + imag*imag; }
+    double real,imag;
+};
+
+std::ostream& operator << ( std::ostream& out, const Complex& c );
+
+/** Vrai si c appartient à une zone de convergence connue (cardioïde
+ *  principale, bulbe de période 2 et disques inscrits dans les bulbes de
+ *  période 3 et 4) : inutile alors d'itérer, le résultat est maxIter.
+ **/
+bool isInKnownConvergenceZone( const Complex& c );
+
+/** Pour un c complexe donné, calcul le nombre d'itérations de mandelbrot
+ * nécessaires pour détecter une éventuelle divergence. Si la suite
+ * converge, la fonction retourne la valeur maxIter
+ **/
+int iterMandelbrot( int maxIter, const Complex& c);
+
+/** Active (défaut) ou non la détection de cycle dans la boucle
+ *  d'échappement : une orbite qui retombe sur un point déjà visité est
+ *  sur un cycle attractif, on renvoie alors maxIter sans aller au bout.
+ **/
+void setPeriodicityCheck( bool check );
+
+/** Noyaux disponibles pour itérer plusieurs pixels à la fois :
+ *    - scalar    : un pixel après l'autre avec iterMandelbrot ;
+ *    - avx2      : 4 pixels par registre (doubles) ;
+ *    - avx512    : 8 pixels par registre (doubles) ;
+ *    - automatic : le plus large supporté par le processeur (défaut).
+ *  Tous donnent exactement les mêmes nombres d'itérations.
+ **/
+enum simd_kernel { automatic, scalar, avx2, avx512 };
+void setSimdKernel( simd_kernel kernel );
+/** Noyau effectivement utilisé (automatic est résolu selon le processeur) */
+simd_kernel getSimdKernel();
+const char* simdKernelName( simd_kernel kernel );
+/** Inverse de simdKernelName (automatic pour un nom inconnu) */
+simd_kernel simdKernelFromName( const std::string& name );
+
+/** Calcule les nombres d'itérations de n points c = (cre[k], cim[k])
+ *  avec le noyau, la précision et la fractale courants (voir
+ *  setSimdKernel, setPrecision et setFractal).
+ **/
+void iterMandelbrotPoints( int maxIter, int n, const double* cre, const double* cim, int* nbIters );
+
+/** Précision des réels dans la boucle d'échappement :
+ *    - single_precision : float, deux fois plus de voies par registre ;
+ *    - double_precision : double (défaut) ;
+ *    - double_double    : environ 106 bits (DoubleDouble.hpp), pour les
+ *                         vues trop profondes pour le double.
+ *  setPrecision choisit entre float et double pour iterMandelbrotPoints
+ *  (et donc computeMandelbrotSetRow) ; le double-double n'a de sens que
+ *  si les points eux-mêmes sont connus en double-double, il passe par
+ *  iterMandelbrotPointsDD.
+ **/
+enum precision { single_precision, double_precision, double_double };
+void setPrecision( precision prec );
+precision getPrecision();
+const char* precisionName( precision prec );
+
+/** Vrai si, avec la précision prec, l'écart spacing entre deux pixels
+ *  voisins est assez grand devant la résolution des coordonnées de c
+ *  (de l'ordre de magnitude)
+ **/
+bool precisionResolves( precision prec, double magnitude, double spacing );
+/** Précision la moins coûteuse qui résout la vue (double_double si même
+ *  le double ne suffit pas)
+ **/
+precision selectPrecision( double magnitude, double spacing );
+
+/** Comme iterMandelbrotPoints, pour des points donnés en double-double
+ *  (cre[k] = creHi[k] + creLo[k], de même pour cim)
+ **/
+void iterMandelbrotPointsDD( int maxIter, int n, const double* creHi, const double* creLo,
+                             const double* cimHi, const double* cimLo, int* nbIters );
+
+/** Fractales à temps d'échappement (voir EscapeKernels.hpp) :
+ *    - mandelbrot_fractal   : z -> z^d + c, z_0 = 0 (Multibrot pour d > 2) ;
+ *    - julia_fractal        : z -> z^d + (juliaRe, juliaIm), z_0 = point ;
+ *    - burning_ship_fractal : z -> (|Re z| + i|Im z|)^d + c, z_0 = 0.
+ *  Le degré va de 2 à maxFractalDegree ; l'échappement est toujours
+ *  |z| >= 2 (suffisant si |c| <= 2 pour Julia). Chaque (variante, degré)
+ *  est une instance compilée du noyau générique, puissance développée.
+ **/
+enum fractal_variant { mandelbrot_fractal, julia_fractal, burning_ship_fractal };
+const int maxFractalDegree = 8;
+struct Fractal
+{
+    fractal_variant variant;
+    int degree;
+    double juliaRe, juliaIm;
+};
+/** Fractale calculée par iterMandelbrotPoints (et donc tous les moteurs
+ *  de rendu) ; par défaut z*z + c, avec les noyaux écrits à la main.
+ **/
+void setFractal( const Fractal& fractal );
+Fractal getFractal();
+bool isQuadraticMandelbrot( const Fractal& fractal );
+const char* fractalVariantName( fractal_variant variant );
+/** Comme iterMandelbrotPoints, mais toujours avec le noyau générique
+ *  instancié pour fractal (même pour z*z + c : sert de comparaison)
+ **/
+void iterEscapePoints( const Fractal& fractal, int maxIter, int n, const double* cre, const double* cim,
+                       int* nbIters );
+
+/** Fenêtre [xmin,xmax] x [ymin,ymax] du plan complexe représentée par
+ *  l'image. Par défaut [-2,1] x [-1.125,1.125].
+ **/
+void setViewport( double xmin, double xmax, double ymin, double ymax );
+
+/** Calcul d'une ligne d'image (mêmes arguments que computeMandelbrotSetRow) */
+typedef std::function<void(int W, int H, int maxIter, int num_ligne, int* pixels)> RowRenderer;
+/** Remplace le calcul en double de computeMandelbrotSetRow par renderer
+ *  (par exemple le zoom profond par perturbation). Un renderer vide
+ *  rétablit le calcul standard.
+ **/
+void setRowRenderer( const RowRenderer& renderer );
+
+/** Point c associé au pixel (num_ligne, num_colonne) de l'image W x H.
+ *  Tous les moteurs de rendu passent par cette fonction pour calculer
+ *  exactement les mêmes valeurs de c.
+ **/
+Complex pixelToComplex( int W, int H, int num_ligne, int num_colonne );
+
+/** Calcule la ligne num_ligne de l'image W x H (W pixels rangés dans pixels) */
+void computeMandelbrotSetRow( int W, int H, int maxIter, int num_ligne, int* pixels);
+
+#endif
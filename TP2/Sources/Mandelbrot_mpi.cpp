@@ -5,93 +5,129 @@
 # include <cmath>
 # include <vector>
 # include <fstream>
+# include <algorithm>
+# include <deque>
+# include <list>
+# include <memory>
+# include <sstream>
+# include <stdexcept>
+# include <thread>
+# include <omp.h>
 # include <mpi.h>
+# include "MandelbrotKernel.hpp"
+# include "DeepZoom.hpp"
+# include "Palette.hpp"
 
 MPI_Comm globComm;
-/** Une structure complexe est définie pour la bonne raison que la classe
- * complex proposée par g++ est très lente ! Le calcul est bien plus rapide
- * avec la petite structure donnée ci--dessous
+
+/** Temps passé par chaque processus à calculer des lignes (busy), cumulé
+ *  sur tous ses threads ; le reste du temps de calcul de l'ensemble est
+ *  passé à communiquer ou à attendre (idle).
  **/
-struct Complex
-{
-    Complex() : real(0.), imag(0.)
-    {}
-    Complex(double r, double i) : real(r), imag(i)
-    {}
-    Complex operator + ( const Complex& z )
-    {
-        return Complex(real + z.real, imag + z.imag );
-    }
-    Complex operator * ( const Complex& z )
-    {
-        return Complex(real*z.real-imag*z.imag, real*z.imag+imag*z.real);
-    }
-    double sqNorm() { return real*real + imag*imag; }
-    double real,imag;
-};
+double busyTime = 0.;
 
-std::ostream& operator << ( std::ostream& out, const Complex& c )
+/** Calcule la ligne num_ligne en comptabilisant le temps dans busyTime */
+void
+timedComputeRow( int W, int H, int maxIter, int num_ligne, int* pixels )
 {
-  out << "(" << c.real << "," << c.imag << ")" << std::endl;
-  return out;
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    computeMandelbrotSetRow(W, H, maxIter, num_ligne, pixels);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+#   pragma omp atomic
+    busyTime += elapsed_seconds.count();
 }
 
-/** Pour un c complexe donné, calcul le nombre d'itérations de mandelbrot
- * nécessaires pour détecter une éventuelle divergence. Si la suite
- * converge, la fonction retourne la valeur maxIter
+/** Lignes calculées par un processus, déjà converties en couleurs.
+ *
+ *  En sortie distribuée, chaque processus garde les lignes qu'il a
+ *  calculées et les écrit lui-même à leur place dans le fichier PPM
+ *  (MPI-IO) : le maître ne reçoit plus que des numéros de ligne et
+ *  l'image n'est jamais rassemblée en entier dans un seul processus.
  **/
-int iterMandelbrot( int maxIter, const Complex& c)
+class LocalRows
 {
-    Complex z{0.,0.};
-    // On vérifie dans un premier temps si le complexe
-    // n'appartient pas à une zone de convergence connue :
-    // Appartenance aux disques  C0{(0,0),1/4} et C1{(-1,0),1/4}
-    if ( c.real*c.real+c.imag*c.imag < 0.0625 )
-        return maxIter;
-    if ( (c.real+1)*(c.real+1)+c.imag*c.imag < 0.0625 )
-        return maxIter;
-    // Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))}    
-    if ((c.real > -0.75) && (c.real < 0.5) ) {
-        Complex ct{c.real-0.25,c.imag};
-        double ctnrm2 = sqrt(ct.sqNorm());
-        if (ctnrm2 < 0.5*(1-ct.real/ctnrm2)) return maxIter;
-    }
-    int niter = 0;
-    while ((z.sqNorm() < 4.) && (niter < maxIter))
+public:
+    LocalRows( int W, int maxIter ) : m_W(W), m_scaleCol(1./maxIter) {}
+
+    /** Range la ligne num_ligne (appelable par plusieurs threads) */
+    void add( int num_ligne, const int* nbIters )
     {
-        z = z*z + c;
-        ++niter;
+        std::vector<unsigned char> rgb(3*m_W);
+        for ( int j = 0; j < m_W; ++j )
+            iterToColour(m_scaleCol, nbIters[j], rgb.data() + 3*j);
+#       pragma omp critical(localRows)
+        {
+            m_rows.push_back(num_ligne);
+            m_rgb.insert(m_rgb.end(), rgb.begin(), rgb.end());
+        }
     }
-    return niter;
-}
 
-/**
- * On parcourt chaque pixel de l'espace image et on fait correspondre par
- * translation et homothétie une valeur complexe c qui servira pour
- * itérer sur la suite de Mandelbrot. Le nombre d'itérations renvoyé
- * servira pour construire l'image finale.
- 
- Sortie : un vecteur de taille W*H avec pour chaque case un nombre d'étape de convergence de 0 à maxIter
- MODIFICATION DE LA FONCTION :
- j'ai supprimé le paramètre W étant donné que maintenant, cette fonction ne prendra plus que des lignes de taille W en argument.
- **/
-void 
-computeMandelbrotSetRow( int W, int H, int maxIter, int num_ligne, int* pixels)
-{
-    // Calcul le facteur d'échelle pour rester dans le disque de rayon 2
-    // centré en (0,0)
-    double scaleX = 3./(W-1);
-    double scaleY = 2.25/(H-1.);
-    //
-    // On parcourt les pixels de l'espace image :
-    for ( int j = 0; j < W; ++j ) {
-       Complex c{-2.+j*scaleX,-1.125+ num_ligne*scaleY};
-       pixels[j] = iterMandelbrot( maxIter, c );
+    /** Écriture collective du fichier : le processus 0 écrit l'en-tête, puis
+     *  chaque processus écrit ses lignes en un seul MPI_File_write_all, à
+     *  travers une vue décrivant leurs positions dans le fichier.
+     **/
+    void write( MPI_Comm comm, const char* filename, int H ) const
+    {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        std::ostringstream header;
+        header << "P6\n" << m_W << " " << H << "\n255\n";
+        MPI_Offset headerSize = MPI_Offset(header.str().size());
+        MPI_File fh;
+        int err = MPI_File_open(comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                                MPI_INFO_NULL, &fh);
+        if ( err != MPI_SUCCESS )
+            throw std::runtime_error(std::string("Impossible d'ouvrir ") + filename);
+        MPI_File_set_size(fh, headerSize + MPI_Offset(3)*m_W*H);
+        if ( rank == 0 )
+            MPI_File_write_at(fh, 0, header.str().data(), int(headerSize), MPI_CHAR,
+                              MPI_STATUS_IGNORE);
+        // La vue doit avoir des déplacements croissants : on trie les lignes
+        // par position dans le fichier (la ligne i est rangée en H-i-1) et on
+        // va chercher chacune à sa place dans m_rgb
+        int nbRows = int(m_rows.size());
+        std::vector<int> order(nbRows);
+        for ( int k = 0; k < nbRows; ++k ) order[k] = k;
+        std::sort(order.begin(), order.end(),
+                  [this] ( int a, int b ) { return m_rows[a] > m_rows[b]; });
+        std::vector<int> fileDispl(nbRows), memDispl(nbRows);
+        for ( int k = 0; k < nbRows; ++k ) {
+            fileDispl[k] = H - m_rows[order[k]] - 1;
+            memDispl[k]  = order[k];
+        }
+        MPI_Datatype rowType, fileType, memType;
+        MPI_Type_contiguous(3*m_W, MPI_BYTE, &rowType);
+        MPI_Type_create_indexed_block(nbRows, 1, fileDispl.data(), rowType, &fileType);
+        MPI_Type_create_indexed_block(nbRows, 1, memDispl.data(), rowType, &memType);
+        MPI_Type_commit(&fileType);
+        MPI_Type_commit(&memType);
+        MPI_File_set_view(fh, headerSize, MPI_BYTE, fileType, "native", MPI_INFO_NULL);
+        MPI_File_write_all(fh, m_rgb.data(), ( nbRows > 0 ? 1 : 0 ), memType, MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+        MPI_Type_free(&memType);
+        MPI_Type_free(&fileType);
+        MPI_Type_free(&rowType);
     }
-}
+private:
+    int m_W;
+    double m_scaleCol;
+    std::vector<int> m_rows;          // Numéros des lignes, dans l'ordre de calcul
+    std::vector<unsigned char> m_rgb; // Leurs couleurs, 3*W octets par ligne
+};
+
+/** Dans les versions suivantes, local est nul si l'image est rassemblée
+ *  sur le maître (valeur renvoyée, vide sur les esclaves) ; sinon chaque
+ *  processus range ses lignes dans local et le maître ne reçoit que leurs
+ *  numéros (la valeur renvoyée est vide partout).
+ **/
 
+/** Version maître-esclave ligne par ligne : chaque esclave reçoit un
+ *  numéro de ligne, la calcule, la renvoie et attend la suivante.
+ **/
 std::vector<int>
-computeMandelbrotSet( int W, int H, int maxIter )
+computeMandelbrotSetRowByRow( int W, int H, int maxIter, LocalRows* local )
 {
     int rank, nbp;
     MPI_Status bordereau;
@@ -103,8 +139,7 @@ computeMandelbrotSet( int W, int H, int maxIter )
     start = std::chrono::system_clock::now();
     if ( rank == 0 ) // Master process
     {
-        std::vector<int>(W*H).swap(pixels);
-        pixels.resize(W*H);
+        if ( !local ) std::vector<int>(W*H).swap(pixels);
         int ind_row = 0;
         for ( int p = 1; p < nbp; ++p )
         {
@@ -125,7 +160,7 @@ computeMandelbrotSet( int W, int H, int maxIter )
 	    // J'envoie une nouvelle ligne à calculer au processus dont je viens de recevoir le résultat.
             MPI_Send(&ind_row, 1, MPI_INT, sender, 101, globComm);
             ind_row += 1;
-            std::copy(row.begin(), row.end(), pixels.data() + (H-irow-1) * W );
+            if ( !local ) std::copy(row.begin(), row.end(), pixels.data() + (H-irow-1) * W );
         }
 	// Arrivé ici, j'ai demandé aux esclaves toutes les lignes à calculer, plus de travail à faire
         ind_row = -1; // Signal de terminaison
@@ -139,7 +174,7 @@ computeMandelbrotSet( int W, int H, int maxIter )
             int irow    = bordereau.MPI_TAG;
 	    // J'envoie un signal de terminaison à l'esclave
             MPI_Send(&ind_row, 1, MPI_INT, sender, 101, globComm ); 
-            std::copy(row.begin(), row.end(), pixels.data() + (H-irow-1) * W );
+            if ( !local ) std::copy(row.begin(), row.end(), pixels.data() + (H-irow-1) * W );
         }
     }
     else // Slaves
@@ -151,9 +186,11 @@ computeMandelbrotSet( int W, int H, int maxIter )
         while (irow >= 0)
         {
 		// Je calcule la ligne
-            computeMandelbrotSetRow(W, H, maxIter, irow, row.data() );
+            timedComputeRow(W, H, maxIter, irow, row.data() );
 	    // J'envoie le résultat au maître (de rang 0) avec pour tag le n° de la ligne que j'ai calculé
-            MPI_Send(row.data(), W, MPI_INT, 0, irow, globComm);
+            // (en sortie distribuée, je garde la ligne et le message est vide)
+            if ( local ) local->add(irow, row.data());
+            MPI_Send(row.data(), ( local ? 0 : W ), MPI_INT, 0, irow, globComm);
 	    // J'attend une nouvelle ligne à calculer
             MPI_Recv(&irow, 1, MPI_INT, 0, 101, globComm, &bordereau);
         }// Je sors de cette boucle si le n° de ligne donné est < 0 (signal de terminaison)
@@ -165,6 +202,612 @@ computeMandelbrotSet( int W, int H, int maxIter )
     return pixels;
 }
 
+/** Version maître-esclave par paquets de lignes, avec anticipation.
+ *
+ *  Le maître distribue des paquets de lignes consécutives [first, first+count[
+ *  dont la taille décroît au fil du calcul (comme un schedule guided
+ *  d'OpenMP) : gros paquets au début pour limiter les messages, petits à
+ *  la fin pour équilibrer la charge. Chaque esclave a toujours un paquet
+ *  d'avance : pendant qu'il calcule un paquet, le suivant est déjà reçu
+ *  (MPI_Irecv posté à l'avance) et il n'attend plus le maître entre deux
+ *  paquets. Les résultats partent en MPI_Isend.
+ *
+ *  Entre deux traitements de messages, le maître calcule lui-même des
+ *  lignes, une à la fois pour répondre vite aux esclaves.
+ **/
+namespace {
+    const int tagWork = 101;   // maître -> esclave : {first, count}, count = 0 pour terminer
+    const int tagResult = 102; // esclave -> maître : first puis les count lignes calculées
+                               // (ou seulement {first, count} en sortie distribuée)
+
+    /* Taille du prochain paquet quand il reste remaining lignes */
+    int guidedBatchSize( int remaining, int nbp )
+    {
+        int count = remaining/(2*nbp);
+        return ( count < 1 ? 1 : count );
+    }
+}
+
+std::vector<int>
+computeMandelbrotSetBatched( int W, int H, int maxIter, LocalRows* local )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    std::vector<int> pixels;
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    if ( rank == 0 ) // Master process
+    {
+        if ( !local ) std::vector<int>(W*H).swap(pixels);
+        std::vector<int> results, row(local ? W : 0);
+        int next_row = 0, nb_rows_done = 0;
+        std::vector<bool> terminated(nbp, false);
+        // Envoie au processus p le prochain paquet, ou le signal de terminaison
+        auto sendWork = [&] ( int p ) {
+            int work[2] = { next_row, 0 };
+            if ( next_row < H ) {
+                work[1] = guidedBatchSize(H-next_row, nbp);
+                next_row += work[1];
+            } else
+                terminated[p] = true;
+            MPI_Send(work, 2, MPI_INT, p, tagWork, globComm);
+        };
+        // Deux paquets d'avance pour chaque esclave
+        for ( int depth = 0; depth < 2; ++depth )
+            for ( int p = 1; p < nbp; ++p )
+                if ( !terminated[p] ) sendWork(p);
+        while ( nb_rows_done < H )
+        {
+            MPI_Status status;
+            int flag = 0;
+            if ( next_row < H )
+                MPI_Iprobe(MPI_ANY_SOURCE, tagResult, globComm, &flag, &status);
+            else {
+                // Plus rien à calculer pour le maître : on attend les résultats
+                MPI_Probe(MPI_ANY_SOURCE, tagResult, globComm, &status);
+                flag = 1;
+            }
+            if ( flag ) {
+                int size;
+                MPI_Get_count(&status, MPI_INT, &size);
+                results.resize(size);
+                MPI_Recv(results.data(), size, MPI_INT, status.MPI_SOURCE, tagResult,
+                         globComm, &status);
+                int first = results[0], count = ( local ? results[1] : (size-1)/W );
+                if ( !terminated[status.MPI_SOURCE] ) sendWork(status.MPI_SOURCE);
+                if ( !local )
+                    for ( int k = 0; k < count; ++k )
+                        std::copy(results.begin() + 1 + k*W, results.begin() + 1 + (k+1)*W,
+                                  pixels.data() + (H-first-k-1) * W );
+                nb_rows_done += count;
+            } else {
+                // Pas de message en attente : le maître calcule une ligne
+                int irow = next_row++;
+                if ( local ) {
+                    timedComputeRow(W, H, maxIter, irow, row.data() );
+                    local->add(irow, row.data());
+                } else
+                    timedComputeRow(W, H, maxIter, irow, pixels.data() + (H-irow-1) * W );
+                nb_rows_done += 1;
+            }
+        }
+    }
+    else // Slaves
+    {
+        int current[2], prefetched[2];
+        MPI_Request reqWork;
+        // Deux tampons de résultats : on calcule dans l'un pendant que
+        // l'autre part vers le maître
+        std::vector<int> buffers[2];
+        MPI_Request reqResult[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+        int ibuf = 0;
+        MPI_Recv(current, 2, MPI_INT, 0, tagWork, globComm, MPI_STATUS_IGNORE);
+        if ( current[1] > 0 )
+            MPI_Irecv(prefetched, 2, MPI_INT, 0, tagWork, globComm, &reqWork);
+        while ( current[1] > 0 )
+        {
+            std::vector<int>& buffer = buffers[ibuf];
+            MPI_Wait(&reqResult[ibuf], MPI_STATUS_IGNORE);
+            buffer.resize(1 + current[1]*W);
+            buffer[0] = current[0];
+            for ( int k = 0; k < current[1]; ++k ) {
+                timedComputeRow(W, H, maxIter, current[0]+k, buffer.data() + 1 + k*W );
+                if ( local ) local->add(current[0]+k, buffer.data() + 1 + k*W);
+            }
+            if ( local ) buffer[1] = current[1];
+            MPI_Isend(buffer.data(), ( local ? 2 : 1 + current[1]*W ), MPI_INT, 0, tagResult,
+                      globComm, &reqResult[ibuf]);
+            ibuf = 1 - ibuf;
+            // Le paquet suivant est normalement déjà arrivé
+            MPI_Wait(&reqWork, MPI_STATUS_IGNORE);
+            current[0] = prefetched[0];
+            current[1] = prefetched[1];
+            if ( current[1] > 0 )
+                MPI_Irecv(prefetched, 2, MPI_INT, 0, tagWork, globComm, &reqWork);
+        }
+        MPI_Waitall(2, reqResult, MPI_STATUSES_IGNORE);
+    }
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
+              << std::endl;
+    return pixels;
+}
+
+/** Version hybride MPI + OpenMP : un processus MPI par nœud (ou par
+ *  socket), par exemple :
+ *      OMP_NUM_THREADS=32 mpirun --map-by ppr:1:socket --bind-to socket ./Mandelbrot_mpi.exe avx512 hybrid
+ *
+ *  Entre processus, on garde le protocole par paquets de lignes avec un
+ *  paquet d'avance. Dans chaque processus, le thread 0 est le seul à faire
+ *  des appels MPI (MPI_THREAD_FUNNELED) : il reçoit les paquets, les range
+ *  dans une file de lignes partagée et renvoie les paquets terminés. Les
+ *  autres threads se servent dans cette file au fur et à mesure (partage
+ *  dynamique, ligne par ligne). Quand il n'a pas de message à traiter, le
+ *  thread 0 calcule lui aussi une ligne. Sur le processus 0, les threads
+ *  prennent directement leurs lignes dans le réservoir global.
+ **/
+namespace {
+    struct LocalBatch
+    {
+        int first, count, remaining;
+        bool sent;
+        MPI_Request request;
+        std::vector<int> buffer; // first puis les count lignes, comme en mode batch
+                                 // (ou {first, count} en sortie distribuée)
+    };
+}
+
+std::vector<int>
+computeMandelbrotSetHybrid( int W, int H, int maxIter, LocalRows* local )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    std::vector<int> pixels;
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    if ( rank == 0 ) // Master process
+    {
+        if ( !local ) std::vector<int>(W*H).swap(pixels);
+        int next_row = 0;     // Réservoir global, protégé par critical(pool)
+        int nb_rows_done = 0; // Mis à jour en atomic
+        std::vector<bool> terminated(nbp, false);
+        // Retire du réservoir un paquet (guided) ou une seule ligne
+        auto takeRows = [&] ( bool batch, int& first ) {
+            int count;
+#           pragma omp critical(pool)
+            {
+                int remaining = H - next_row;
+                count = ( batch ? std::min(guidedBatchSize(remaining, nbp), remaining )
+                                : std::min(1, remaining) );
+                first = next_row;
+                next_row += count;
+            }
+            return count;
+        };
+        auto computeOwnRow = [&] ( int irow ) {
+            if ( local ) {
+                std::vector<int> row(W);
+                timedComputeRow(W, H, maxIter, irow, row.data() );
+                local->add(irow, row.data());
+            } else
+                timedComputeRow(W, H, maxIter, irow, pixels.data() + (H-irow-1) * W );
+#           pragma omp atomic
+            nb_rows_done += 1;
+        };
+        auto sendWork = [&] ( int p ) {
+            int work[2];
+            work[1] = takeRows(true, work[0]);
+            if ( work[1] == 0 ) terminated[p] = true;
+            MPI_Send(work, 2, MPI_INT, p, tagWork, globComm);
+        };
+#       pragma omp parallel
+        {
+            if ( omp_get_thread_num() == 0 ) {
+                // Thread de communication
+                std::vector<int> results;
+                for ( int depth = 0; depth < 2; ++depth )
+                    for ( int p = 1; p < nbp; ++p )
+                        if ( !terminated[p] ) sendWork(p);
+                while ( true ) {
+                    int done;
+#                   pragma omp atomic read
+                    done = nb_rows_done;
+                    if ( done == H ) break;
+                    MPI_Status status;
+                    int flag = 0, first;
+                    MPI_Iprobe(MPI_ANY_SOURCE, tagResult, globComm, &flag, &status);
+                    if ( flag ) {
+                        int size;
+                        MPI_Get_count(&status, MPI_INT, &size);
+                        results.resize(size);
+                        MPI_Recv(results.data(), size, MPI_INT, status.MPI_SOURCE, tagResult,
+                                 globComm, &status);
+                        if ( !terminated[status.MPI_SOURCE] ) sendWork(status.MPI_SOURCE);
+                        first = results[0];
+                        int count = ( local ? results[1] : (size-1)/W );
+                        if ( !local )
+                            for ( int k = 0; k < count; ++k )
+                                std::copy(results.begin() + 1 + k*W, results.begin() + 1 + (k+1)*W,
+                                          pixels.data() + (H-first-k-1) * W );
+#                       pragma omp atomic
+                        nb_rows_done += count;
+                    }
+                    else if ( takeRows(false, first) == 1 )
+                        computeOwnRow(first);
+                    else
+                        std::this_thread::yield();
+                }
+            } else {
+                // Threads de calcul
+                int first;
+                while ( takeRows(false, first) == 1 ) computeOwnRow(first);
+            }
+        }
+    }
+    else // Slaves
+    {
+        std::list<LocalBatch> batches;                  // protégés par critical(queue)
+        std::deque<std::pair<LocalBatch*,int>> tasks;   // (paquet, ligne dans le paquet)
+        bool noMoreWork = false;
+        // Retire une ligne de la file et la calcule ; faux si la file est vide
+        auto computeOneTask = [&] () {
+            std::pair<LocalBatch*,int> task(nullptr, 0);
+#           pragma omp critical(queue)
+            if ( !tasks.empty() ) {
+                task = tasks.front();
+                tasks.pop_front();
+            }
+            if ( task.first == nullptr ) return false;
+            LocalBatch& batch = *task.first;
+            if ( local ) {
+                std::vector<int> row(W);
+                timedComputeRow(W, H, maxIter, batch.first + task.second, row.data() );
+                local->add(batch.first + task.second, row.data());
+            } else
+                timedComputeRow(W, H, maxIter, batch.first + task.second,
+                                batch.buffer.data() + 1 + task.second*W );
+#           pragma omp critical(queue)
+            batch.remaining -= 1;
+            return true;
+        };
+#       pragma omp parallel
+        {
+            if ( omp_get_thread_num() == 0 ) {
+                // Thread de communication
+                int work[2];
+                MPI_Request reqWork;
+                bool termReceived = false;
+                MPI_Irecv(work, 2, MPI_INT, 0, tagWork, globComm, &reqWork);
+                while ( true ) {
+                    bool busy = false;
+                    int flag = 0;
+                    if ( !termReceived ) MPI_Test(&reqWork, &flag, MPI_STATUS_IGNORE);
+                    if ( flag ) {
+                        busy = true;
+                        if ( work[1] == 0 ) {
+                            termReceived = true;
+#                           pragma omp critical(queue)
+                            noMoreWork = true;
+                        } else {
+                            LocalBatch batch{work[0], work[1], work[1], false, MPI_REQUEST_NULL,
+                                             std::vector<int>(local ? 2 : 1 + work[1]*W)};
+                            batch.buffer[0] = work[0];
+                            if ( local ) batch.buffer[1] = work[1];
+#                           pragma omp critical(queue)
+                            {
+                                batches.push_back(std::move(batch));
+                                for ( int k = 0; k < work[1]; ++k )
+                                    tasks.emplace_back(&batches.back(), k);
+                            }
+                            // On anticipe tout de suite le paquet suivant
+                            MPI_Irecv(work, 2, MPI_INT, 0, tagWork, globComm, &reqWork);
+                        }
+                    }
+                    // Renvoie les paquets terminés et libère ceux déjà partis
+                    std::vector<LocalBatch*> toSend;
+                    bool allSent = true;
+#                   pragma omp critical(queue)
+                    for ( auto it = batches.begin(); it != batches.end(); ) {
+                        if ( it->sent ) {
+                            int sentFlag;
+                            MPI_Test(&it->request, &sentFlag, MPI_STATUS_IGNORE);
+                            if ( sentFlag ) { it = batches.erase(it); continue; }
+                        } else if ( it->remaining == 0 ) {
+                            it->sent = true;
+                            toSend.push_back(&*it);
+                        }
+                        allSent = false;
+                        ++it;
+                    }
+                    for ( LocalBatch* batch : toSend ) {
+                        MPI_Isend(batch->buffer.data(), int(batch->buffer.size()), MPI_INT, 0,
+                                  tagResult, globComm, &batch->request);
+                        busy = true;
+                    }
+                    if ( termReceived && allSent ) break;
+                    if ( !busy && !computeOneTask() ) std::this_thread::yield();
+                }
+            } else {
+                // Threads de calcul
+                while ( true ) {
+                    if ( computeOneTask() ) continue;
+                    bool finished;
+#                   pragma omp critical(queue)
+                    finished = noMoreWork && tasks.empty();
+                    if ( finished ) break;
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
+              << std::endl;
+    return pixels;
+}
+
+/** Répartitions statiques et vol de travail.
+ *
+ *  Une répartition statique est décrite par owner : owner[i] est le rang
+ *  du processus qui calcule la ligne i. Chaque processus calcule ses
+ *  lignes sans aucun message, puis l'image est rassemblée sur le
+ *  processus 0 (ou chacun écrit ses lignes en sortie distribuée).
+ *   - block  : H/nbp lignes consécutives par processus ;
+ *   - cyclic : ligne i au processus i % nbp ;
+ *   - cost   : blocs de lignes consécutives de même coût prévu d'après un
+ *              aperçu (une ligne sur previewStep, calculée et chronométrée
+ *              en répartition cyclique, puis interpolée). Les lignes de
+ *              l'aperçu sont gardées : il ne coûte aucun calcul en plus.
+ **/
+namespace {
+    const int previewStep = 16;
+
+    /* Lignes calculées par un processus, en attendant le rassemblement */
+    struct ComputedRows
+    {
+        std::vector<int> rows;
+        std::vector<int> pixels; // W entiers par ligne, dans l'ordre de rows
+    };
+
+    void computeRowInto( int W, int H, int maxIter, int irow, LocalRows* local, ComputedRows& done )
+    {
+        if ( local ) {
+            std::vector<int> row(W);
+            timedComputeRow(W, H, maxIter, irow, row.data() );
+            local->add(irow, row.data());
+        } else {
+            done.rows.push_back(irow);
+            done.pixels.resize(done.rows.size()*W);
+            timedComputeRow(W, H, maxIter, irow, done.pixels.data() + (done.rows.size()-1)*W );
+        }
+    }
+
+    /* Rassemble sur le processus 0 les lignes calculées par chacun (rien à
+     * faire en sortie distribuée : les lignes sont déjà dans local) */
+    std::vector<int> gatherRows( int W, int H, const ComputedRows& done, LocalRows* local )
+    {
+        std::vector<int> pixels;
+        if ( local ) return pixels;
+        int rank, nbp;
+        MPI_Comm_rank(globComm, &rank);
+        MPI_Comm_size(globComm, &nbp );
+        int nbRows = int(done.rows.size());
+        std::vector<int> counts(nbp), displs(nbp, 0), allRows, allPixels;
+        MPI_Gather(&nbRows, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, globComm);
+        if ( rank == 0 ) {
+            for ( int p = 1; p < nbp; ++p ) displs[p] = displs[p-1] + counts[p-1];
+            allRows.resize(H);
+        }
+        MPI_Gatherv(done.rows.data(), nbRows, MPI_INT, allRows.data(), counts.data(),
+                    displs.data(), MPI_INT, 0, globComm);
+        if ( rank == 0 ) {
+            for ( int p = 0; p < nbp; ++p ) { counts[p] *= W; displs[p] *= W; }
+            allPixels.resize(W*H);
+        }
+        MPI_Gatherv(done.pixels.data(), nbRows*W, MPI_INT, allPixels.data(), counts.data(),
+                    displs.data(), MPI_INT, 0, globComm);
+        if ( rank == 0 ) {
+            pixels.resize(W*H);
+            for ( int k = 0; k < H; ++k )
+                std::copy(allPixels.begin() + k*W, allPixels.begin() + (k+1)*W,
+                          pixels.data() + (H-allRows[k]-1) * W );
+        }
+        return pixels;
+    }
+
+    /* Première ligne du bloc du processus p en répartition block */
+    int blockFirstRow( int p, int H, int nbp ) { return int((long(p)*H)/nbp); }
+
+    /* Coupe les lignes en nbp blocs consécutifs de coûts prévus égaux */
+    std::vector<int> costPartition( const std::vector<double>& cost, int nbp )
+    {
+        int H = int(cost.size());
+        double total = 0.;
+        for ( double c : cost ) total += c;
+        std::vector<int> owner(H);
+        double prefix = 0.;
+        for ( int i = 0; i < H; ++i ) {
+            // Processus choisi d'après le milieu du coût cumulé de la ligne
+            int p = int(nbp*(prefix + 0.5*cost[i])/total);
+            owner[i] = std::min(std::max(p, 0), nbp-1);
+            prefix += cost[i];
+        }
+        return owner;
+    }
+
+    /* Aperçu pour la répartition cost : calcule (dans done) et chronomètre
+     * les lignes multiples de previewStep, puis renvoie la répartition des
+     * autres lignes (-1 pour celles de l'aperçu) */
+    std::vector<int> previewPartition( int W, int H, int maxIter, LocalRows* local, ComputedRows& done )
+    {
+        int rank, nbp;
+        MPI_Comm_rank(globComm, &rank);
+        MPI_Comm_size(globComm, &nbp );
+        std::vector<double> measured(H, 0.);
+        double start = MPI_Wtime();
+        for ( int i = rank*previewStep; i < H; i += nbp*previewStep ) {
+            double t0 = MPI_Wtime();
+            computeRowInto(W, H, maxIter, i, local, done);
+            measured[i] = MPI_Wtime() - t0;
+        }
+        double previewTime = MPI_Wtime() - start;
+        MPI_Allreduce(MPI_IN_PLACE, measured.data(), H, MPI_DOUBLE, MPI_SUM, globComm);
+        // Coût de chaque ligne interpolé entre les deux lignes d'aperçu qui
+        // l'encadrent (la dernière pour les lignes qui suivent)
+        const int last = ((H-1)/previewStep)*previewStep;
+        std::vector<double> cost(H, 0.);
+        for ( int i = 0; i < H; ++i ) {
+            if ( i % previewStep == 0 ) continue;
+            int i0 = (i/previewStep)*previewStep, i1 = std::min(i0 + previewStep, last);
+            double t = ( i1 > i0 ? double(i - i0)/(i1 - i0) : 0. );
+            cost[i] = (1.-t)*measured[i0] + t*measured[i1] + 1.E-9;
+        }
+        std::vector<int> owner = costPartition(cost, nbp);
+        for ( int i = 0; i < H; i += previewStep ) owner[i] = -1;
+        double maxPreview;
+        MPI_Reduce(&previewTime, &maxPreview, 1, MPI_DOUBLE, MPI_MAX, 0, globComm);
+        if ( rank == 0 )
+            std::cout << "Aperçu : " << (last/previewStep + 1) << " lignes en " << maxPreview
+                      << " s" << std::endl;
+        return owner;
+    }
+}
+
+/** Répartition statique block, cyclic ou cost (voir ci-dessus) **/
+std::vector<int>
+computeMandelbrotSetStatic( int W, int H, int maxIter, const std::string& policy, LocalRows* local )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    ComputedRows done;
+    std::vector<int> owner(H);
+    if ( policy == "cost" )
+        owner = previewPartition(W, H, maxIter, local, done);
+    else if ( policy == "cyclic" )
+        for ( int i = 0; i < H; ++i ) owner[i] = i % nbp;
+    else
+        for ( int p = 0; p < nbp; ++p )
+            for ( int i = blockFirstRow(p, H, nbp); i < blockFirstRow(p+1, H, nbp); ++i )
+                owner[i] = p;
+    for ( int i = 0; i < H; ++i )
+        if ( owner[i] == rank ) computeRowInto(W, H, maxIter, i, local, done);
+    std::vector<int> pixels = gatherRows(W, H, done, local);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
+              << std::endl;
+    return pixels;
+}
+
+/** Vol de travail distribué, sans processus maître.
+ *
+ *  Au départ, chaque processus possède le bloc de la répartition block.
+ *  Le prochain numéro de ligne non distribuée de chaque bloc est exposé
+ *  dans une fenêtre MPI et n'est modifié que par MPI_Fetch_and_op
+ *  (atomique) : le propriétaire y prend ses lignes une à une, et un
+ *  processus qui a fini son bloc vole la moitié de ce qui reste au
+ *  processus le plus chargé, sans que celui-ci participe. Une ligne n'est
+ *  ainsi attribuée qu'une fois ; les fins de blocs sont connues de tous.
+ **/
+std::vector<int>
+computeMandelbrotSetStealing( int W, int H, int maxIter, LocalRows* local )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    start = std::chrono::system_clock::now();
+    int* next;
+    MPI_Win win;
+    MPI_Win_allocate(sizeof(int), sizeof(int), MPI_INFO_NULL, globComm, &next, &win);
+    *next = blockFirstRow(rank, H, nbp);
+    MPI_Barrier(globComm);
+    MPI_Win_lock_all(0, win);
+    // Réserve count lignes du bloc de target : renvoie la première (les
+    // lignes réservées au-delà de la fin du bloc n'existent pas)
+    auto take = [&] ( int target, int count ) {
+        int first;
+        MPI_Fetch_and_op(&count, &first, MPI_INT, target, 0, MPI_SUM, win);
+        MPI_Win_flush(target, win);
+        return first;
+    };
+    ComputedRows done;
+    int stolen = 0;
+    // Mon bloc, une ligne à la fois
+    for ( int i = take(rank, 1); i < blockFirstRow(rank+1, H, nbp); i = take(rank, 1) )
+        computeRowInto(W, H, maxIter, i, local, done);
+    // Puis vol chez le processus auquel il reste le plus de lignes
+    while ( true ) {
+        int victim = -1, maxRemaining = 0;
+        for ( int p = 0; p < nbp; ++p ) {
+            if ( p == rank ) continue;
+            int remaining = blockFirstRow(p+1, H, nbp) - take(p, 0);
+            if ( remaining > maxRemaining ) { maxRemaining = remaining; victim = p; }
+        }
+        if ( victim < 0 ) break;
+        int count = std::max(1, maxRemaining/2);
+        int first = take(victim, count);
+        int last  = std::min(first + count, blockFirstRow(victim+1, H, nbp));
+        for ( int i = first; i < last; ++i ) {
+            computeRowInto(W, H, maxIter, i, local, done);
+            stolen += 1;
+        }
+    }
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+    int totalStolen;
+    MPI_Reduce(&stolen, &totalStolen, 1, MPI_INT, MPI_SUM, 0, globComm);
+    if ( rank == 0 )
+        std::cout << "Lignes volées : " << totalStolen << std::endl;
+    std::vector<int> pixels = gatherRows(W, H, done, local);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> elapsed_seconds = end-start;
+    std::cout << "Temps calcul ensemble mandelbrot : " << elapsed_seconds.count() 
+              << std::endl;
+    return pixels;
+}
+
+/** Affiche sur le processus 0 le temps de calcul (busy) et le temps
+ *  d'attente ou de communication (idle) de chaque processus, puis
+ *  l'efficacité : temps de calcul cumulé / (temps écoulé x nombre de
+ *  cœurs utilisés). On compare ainsi les modes MPI pur et hybride à nombre
+ *  de cœurs égal (par exemple 8 processus en mode batch contre 1
+ *  processus et OMP_NUM_THREADS=8 en mode hybrid), ainsi que le
+ *  déséquilibre : temps de calcul maximal sur temps moyen des processus
+ *  (1 pour une répartition parfaite ; le maître du mode row, qui ne
+ *  calcule pas, compte dans la moyenne).
+ **/
+void
+reportBusyIdle( double wallTime, int nbThreads )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    double loc[3] = { busyTime, wallTime*nbThreads - busyTime, double(nbThreads) };
+    std::vector<double> all(3*nbp);
+    MPI_Gather(loc, 3, MPI_DOUBLE, all.data(), 3, MPI_DOUBLE, 0, globComm);
+    if ( rank == 0 ) {
+        double totalBusy = 0., nbCores = 0., maxBusy = 0.;
+        for ( int p = 0; p < nbp; ++p ) {
+            std::cout << "Processus " << p << " : calcul " << all[3*p] << " s, attente "
+                      << all[3*p+1] << " s" << std::endl;
+            totalBusy += all[3*p];
+            nbCores   += all[3*p+2];
+            maxBusy    = std::max(maxBusy, all[3*p]);
+        }
+        std::cout << "Coeurs utilisés : " << nbCores << ", efficacité : "
+                  << totalBusy/(wallTime*nbCores) << std::endl;
+        std::cout << "Déséquilibre (calcul max/moyen) : " << maxBusy/(totalBusy/nbp) << std::endl;
+    }
+}
+
 /** Construit et sauvegarde l'image finale **/
 void savePicture( const std::string& filename, int W, int H, const std::vector<int>& nbIters, int maxIter )
 {
@@ -173,11 +816,9 @@ void savePicture( const std::string& filename, int W, int H, const std::vector<i
     ofs << "P6\n"
         << W << " " << H << "\n255\n";
     for ( int i = 0; i < W * H; ++i ) {
-        double iter = scaleCol*nbIters[i];
-        unsigned char r = (unsigned char)(256 - (unsigned (iter*256.) & 0xFF));
-        unsigned char b = (unsigned char)(256 - (unsigned (iter*65536) & 0xFF));
-        unsigned char g = (unsigned char)(256 - (unsigned( iter*16777216) & 0xFF));
-        ofs << r << g << b;
+        unsigned char rgb[3];
+        iterToColour(scaleCol, nbIters[i], rgb);
+        ofs << rgb[0] << rgb[1] << rgb[2];
     }
     ofs.close();
 }
@@ -185,18 +826,75 @@ void savePicture( const std::string& filename, int W, int H, const std::vector<i
 int main(int argc, char *argv[] ) 
  { 
     int rank;
-    MPI_Init(&argc, &argv);
+    // Seul le thread principal de chaque processus fait des appels MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     MPI_Comm_dup(MPI_COMM_WORLD, &globComm);
     MPI_Comm_rank(globComm, &rank );
-    const int W = 800;
-    const int H = 600;
+    // Vue optionnelle : --center re im --zoom z --size W H --iter n
+    // (voir DeepZoom.hpp). Chaque processus prépare la vue pour son compte,
+    // orbite de référence comprise en zoom profond.
+    ViewParameters view;
+    try {
+        view = parseViewParameters(argc, argv);
+        installView(view, rank == 0);
+    } catch ( const std::exception& e ) {
+        if ( rank == 0 ) std::cerr << e.what() << std::endl;
+        MPI_Abort(globComm, EXIT_FAILURE);
+    }
+    const int W = view.W;
+    const int H = view.H;
     // Normalement, pour un bon rendu, il faudrait le nombre d'itérations
     // ci--dessous :
     //const int maxIter = 16777216;
-    const int maxIter = 8*65536;
-    auto iters = computeMandelbrotSet( W, H, maxIter );
+    const int maxIter = view.maxIter;
+    // Noyau de calcul optionnel : scalar, avx2 ou avx512 (par défaut le plus
+    // large supporté par le processeur)
+    if ( view.positional.size() > 0 ) setSimdKernel(simdKernelFromName(view.positional[0]));
     if ( rank == 0 )
+        std::cout << "Noyau de calcul : " << simdKernelName(getSimdKernel()) << std::endl;
+    // Répartition optionnelle : batch (maître-esclave par paquets avec
+    // anticipation, défaut), row (maître-esclave ligne par ligne), hybrid
+    // (MPI + OpenMP), block, cyclic, cost (statiques) ou steal (vol de travail)
+    std::string protocol = ( view.positional.size() > 1 ? view.positional[1] : "batch" );
+    if ( (protocol == "hybrid") && (provided < MPI_THREAD_FUNNELED) ) {
+        if ( rank == 0 ) std::cerr << "MPI_THREAD_FUNNELED non supporté par MPI" << std::endl;
+        MPI_Abort(globComm, EXIT_FAILURE);
+    }
+    // Sortie optionnelle : mpiio (chaque processus écrit ses lignes, défaut)
+    // ou gather (image rassemblée et écrite par le processus 0)
+    std::string output = ( view.positional.size() > 2 ? view.positional[2] : "mpiio" );
+    std::unique_ptr<LocalRows> local;
+    if ( output != "gather" ) local.reset(new LocalRows(W, maxIter));
+    std::vector<int> iters;
+    int nbThreads = 1;
+    double start = MPI_Wtime();
+    if ( protocol == "hybrid" ) {
+        nbThreads = omp_get_max_threads();
+        iters = computeMandelbrotSetHybrid( W, H, maxIter, local.get() );
+    }
+    else if ( protocol == "row" )
+        iters = computeMandelbrotSetRowByRow( W, H, maxIter, local.get() );
+    else if ( (protocol == "block") || (protocol == "cyclic") || (protocol == "cost") )
+        iters = computeMandelbrotSetStatic( W, H, maxIter, protocol, local.get() );
+    else if ( protocol == "steal" )
+        iters = computeMandelbrotSetStealing( W, H, maxIter, local.get() );
+    else
+        iters = computeMandelbrotSetBatched( W, H, maxIter, local.get() );
+    double computeEnd = MPI_Wtime();
+    reportBusyIdle( computeEnd - start, nbThreads );
+    // Temps d'écriture : jusqu'à ce que le dernier processus ait fini
+    double startIO = MPI_Wtime();
+    if ( local )
+        local->write(globComm, "mandelbrot.ppm", H);
+    else if ( rank == 0 )
         savePicture("mandelbrot.ppm", W, H, iters, maxIter);
+    MPI_Barrier(globComm);
+    double end = MPI_Wtime();
+    if ( rank == 0 )
+        std::cout << "Temps écriture image (" << ( local ? "mpiio" : "gather" ) << ") : "
+                  << end - startIO << ", temps total : " << (computeEnd - start) + (end - startIO)
+                  << std::endl;
     MPI_Finalize();
     return EXIT_SUCCESS;
  }
@@ -0,0 +1,105 @@
+# include "MandelbrotKernel.hpp"
+# include "MarianiSilver.hpp"
+
+namespace {
+    // En dessous de cette taille, on calcule directement l'intérieur
+    const int minSize  = 6;
+    // En dessous de cette surface, on ne crée plus de nouvelle tâche
+    const int taskArea = 128*128;
+
+    struct Image
+    {
+        int W, H, maxIter;
+        int* pixels;
+        int& at( int i, int j ) { return pixels[W*(H-i-1)+j]; }
+    };
+    // -----------------------------------------------------------------
+    /* Calcule tous les pixels du rectangle [i0,i1]x[j0,j1] (bornes
+     * comprises, éventuellement vide) et les compte dans nbIterated
+     */
+    void computeRect( Image img, int i0, int i1, int j0, int j1, long* nbIterated )
+    {
+        if ( (i0 > i1) || (j0 > j1) ) return;
+        int n = (i1-i0+1)*(j1-j0+1);
+        std::vector<double> cre(n), cim(n);
+        std::vector<int> res(n);
+        int k = 0;
+        for ( int i = i0; i <= i1; ++i )
+            for ( int j = j0; j <= j1; ++j, ++k ) {
+                Complex c = pixelToComplex(img.W, img.H, i, j);
+                cre[k] = c.real;
+                cim[k] = c.imag;
+            }
+        iterMandelbrotPoints(img.maxIter, n, cre.data(), cim.data(), res.data());
+        k = 0;
+        for ( int i = i0; i <= i1; ++i )
+            for ( int j = j0; j <= j1; ++j, ++k )
+                img.at(i,j) = res[k];
+#       pragma omp atomic
+        *nbIterated += n;
+    }
+    // -----------------------------------------------------------------
+    /* Traite le rectangle [i0,i1]x[j0,j1] dont le bord est déjà calculé.
+     * Les deux moitiés d'un rectangle ne partagent que la ligne de coupe,
+     * calculée avant de lancer les tâches : aucune tâche n'écrit dans un
+     * pixel lu ou écrit par une autre.
+     */
+    void subdivide( Image img, int i0, int i1, int j0, int j1, long* nbIterated )
+    {
+        int val = img.at(i0,j0);
+        bool uniform = true;
+        for ( int j = j0; (j <= j1) && uniform; ++j )
+            uniform = (img.at(i0,j) == val) && (img.at(i1,j) == val);
+        for ( int i = i0; (i <= i1) && uniform; ++i )
+            uniform = (img.at(i,j0) == val) && (img.at(i,j1) == val);
+        if ( uniform ) {
+            for ( int i = i0+1; i < i1; ++i )
+                for ( int j = j0+1; j < j1; ++j )
+                    img.at(i,j) = val;
+            return;
+        }
+        if ( (i1-i0 < minSize) || (j1-j0 < minSize) ) {
+            computeRect(img, i0+1, i1-1, j0+1, j1-1, nbIterated);
+            return;
+        }
+        bool spawn = (i1-i0)*(j1-j0) > taskArea;
+        if ( j1-j0 >= i1-i0 ) {
+            // Coupe selon une colonne
+            int jm = (j0+j1)/2;
+            computeRect(img, i0+1, i1-1, jm, jm, nbIterated);
+#           pragma omp task if(spawn)
+            subdivide(img, i0, i1, j0, jm, nbIterated);
+#           pragma omp task if(spawn)
+            subdivide(img, i0, i1, jm, j1, nbIterated);
+        } else {
+            // Coupe selon une ligne
+            int im = (i0+i1)/2;
+            computeRect(img, im, im, j0+1, j1-1, nbIterated);
+#           pragma omp task if(spawn)
+            subdivide(img, i0, im, j0, j1, nbIterated);
+#           pragma omp task if(spawn)
+            subdivide(img, im, i1, j0, j1, nbIterated);
+        }
+    }
+}
+// =====================================================================
+std::vector<int>
+computeMandelbrotSetMarianiSilver( int W, int H, int maxIter, long& nbIterated )
+{
+    std::vector<int> pixels(W*H);
+    Image img{W, H, maxIter, pixels.data()};
+    long count = 0;
+    long* ptCount = &count;
+#   pragma omp parallel
+#   pragma omp single
+    {
+        // Bord de l'image entière, puis subdivision récursive
+        computeRect(img, 0, 0, 0, W-1, ptCount);
+        computeRect(img, H-1, H-1, 0, W-1, ptCount);
+        computeRect(img, 1, H-2, 0, 0, ptCount);
+        computeRect(img, 1, H-2, W-1, W-1, ptCount);
+        subdivide(img, 0, H-1, 0, W-1, ptCount);
+    }
+    nbIterated = count;
+    return pixels;
+}
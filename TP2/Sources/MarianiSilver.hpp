@@ -0,0 +1,22 @@
+#ifndef _MARIANI_SILVER_HPP_
+# define _MARIANI_SILVER_HPP_
+# include <vector>
+
+/** Calcul de l'ensemble de Mandelbrot par l'algorithme de Mariani-Silver.
+ *
+ *  On ne calcule que le bord d'un rectangle de l'image. Si tout le bord a
+ *  le même nombre d'itérations, l'intérieur du rectangle a forcément ce
+ *  nombre d'itérations (les ensembles {c ; n(c) >= k} sont connexes et
+ *  sans trou) et on le remplit sans rien calculer. Sinon on coupe le
+ *  rectangle en deux par une ligne (ou colonne) qu'on calcule, puis on
+ *  recommence sur chaque moitié. Les deux moitiés sont des tâches OpenMP.
+ *  La propriété vaut pour Mandelbrot et Multibrot, pas pour le Burning
+ *  Ship : l'appelant doit alors calculer tous les pixels.
+ *
+ *  Le résultat a la même disposition que celui de computeMandelbrotSet
+ *  (ligne i rangée en W*(H-i-1)). nbIterated reçoit le nombre de pixels
+ *  effectivement calculés.
+ **/
+std::vector<int> computeMandelbrotSetMarianiSilver( int W, int H, int maxIter, long& nbIterated );
+
+#endif
@@ -0,0 +1,118 @@
+# include <cassert>
+# include <cstddef>
+# include <stdexcept>
+# include <string>
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+# include "MatrixAssembly.hpp"
+
+namespace {
+    /* Type MPI décrivant, dans le fichier, le bloc blk de la matrice
+     * globale stockée par colonne (ordre "fortran")
+     */
+    MPI_Datatype fileViewType( const BlockDescr& blk )
+    {
+        assert( (blk.nrows > 0) && (blk.ncols > 0) );
+        int sizes[2]    = { blk.dim, blk.dim };
+        int subsizes[2] = { blk.nrows, blk.ncols };
+        int starts[2]   = { blk.start_row, blk.start_col };
+        MPI_Datatype filetype;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_FORTRAN,
+                                 MPI_DOUBLE, &filetype);
+        MPI_Type_commit(&filetype);
+        return filetype;
+    }
+    // -----------------------------------------------------------------
+    /* En mémoire, le bloc est une suite de ncols colonnes contiguës de
+     * nrows doubles : on compte en colonnes pour ne pas déborder d'un int
+     * quand le bloc dépasse 2^31 coefficients.
+     */
+    MPI_Datatype columnType( const BlockDescr& blk )
+    {
+        MPI_Datatype column;
+        MPI_Type_contiguous(blk.nrows, MPI_DOUBLE, &column);
+        MPI_Type_commit(&column);
+        return column;
+    }
+}
+// =====================================================================
+void
+threadRowRange( int nrows, int& beg, int& end )
+{
+#if defined(_OPENMP)
+    int nbThreads = omp_get_num_threads();
+    int num       = omp_get_thread_num();
+#else
+    int nbThreads = 1;
+    int num       = 0;
+#endif
+    int chunk     = nrows/nbThreads;
+    int remainder = nrows%nbThreads;
+    beg = num*chunk + (num < remainder ? num : remainder);
+    end = beg + chunk + (num < remainder ? 1 : 0);
+}
+// ---------------------------------------------------------------------
+void
+firstTouchBlock( const BlockDescr& blk, double* coefs )
+{
+#   pragma omp parallel
+    {
+        int beg, end;
+        threadRowRange(blk.nrows, beg, end);
+        for ( int j = 0; j < blk.ncols; ++j ) {
+            double* col = coefs + std::size_t(j)*blk.nrows;
+            for ( int i = beg; i < end; ++i ) col[i] = 0.;
+        }
+    }
+}
+// ---------------------------------------------------------------------
+void
+assembleBlock( const BlockDescr& blk, double* coefs )
+{
+#   pragma omp parallel
+    {
+        int beg, end;
+        threadRowRange(blk.nrows, beg, end);
+        for ( int j = 0; j < blk.ncols; ++j ) {
+            double* col = coefs + std::size_t(j)*blk.nrows;
+            // Un seul modulo par colonne, ensuite on incrémente
+            int val = (blk.start_row + beg + blk.start_col + j)%blk.dim;
+            for ( int i = beg; i < end; ++i ) {
+                col[i] = val;
+                if ( ++val == blk.dim ) val = 0;
+            }
+        }
+    }
+}
+// ---------------------------------------------------------------------
+void
+readBlock( MPI_Comm comm, const char* filename, const BlockDescr& blk, double* coefs )
+{
+    MPI_File fh;
+    if ( MPI_File_open(comm, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS )
+        throw std::runtime_error(std::string("Impossible d'ouvrir le fichier ") + filename);
+    MPI_Datatype filetype = fileViewType(blk);
+    MPI_Datatype column   = columnType(blk);
+    MPI_File_set_view(fh, 0, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+    MPI_File_read_all(fh, coefs, blk.ncols, column, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&column);
+    MPI_Type_free(&filetype);
+}
+// ---------------------------------------------------------------------
+void
+writeBlock( MPI_Comm comm, const char* filename, const BlockDescr& blk, const double* coefs )
+{
+    MPI_File fh;
+    if ( MPI_File_open(comm, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                       MPI_INFO_NULL, &fh) != MPI_SUCCESS )
+        throw std::runtime_error(std::string("Impossible de créer le fichier ") + filename);
+    MPI_Datatype filetype = fileViewType(blk);
+    MPI_Datatype column   = columnType(blk);
+    MPI_File_set_view(fh, 0, MPI_DOUBLE, filetype, "native", MPI_INFO_NULL);
+    MPI_File_write_all(fh, const_cast<double*>(coefs), blk.ncols, column, MPI_STATUS_IGNORE);
+    MPI_File_close(&fh);
+    MPI_Type_free(&column);
+    MPI_Type_free(&filetype);
+}
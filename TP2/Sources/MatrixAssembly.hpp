@@ -0,0 +1,85 @@
+#ifndef _MATRIX_ASSEMBLY_HPP_
+# define _MATRIX_ASSEMBLY_HPP_
+# include <memory>
+# include <utility>
+# include <vector>
+# include <mpi.h>
+
+/** Allocateur qui laisse les doubles non initialisés à la construction
+ *  du vecteur.
+ *
+ *  Un std::vector<double>(n) classique met tous ses coefficients à zéro
+ *  depuis le thread qui le construit : c'est alors ce thread qui "touche"
+ *  le premier toutes les pages mémoire et le système les place toutes
+ *  sur son propre banc NUMA. Avec cet allocateur, ce sont les threads
+ *  d'assemblage qui touchent les premiers les pages qu'ils utiliseront.
+ **/
+template<typename T> class NoInitAllocator : public std::allocator<T>
+{
+public:
+    template<typename U> struct rebind { using other = NoInitAllocator<U>; };
+
+    NoInitAllocator() = default;
+    template<typename U> NoInitAllocator( const NoInitAllocator<U>& ) {}
+
+    template<typename U> void construct( U* ptr )
+    {
+        ::new(static_cast<void*>(ptr)) U;
+    }
+    template<typename U, typename... Args> void construct( U* ptr, Args&&... args )
+    {
+        ::new(static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+};
+
+using CoefsArray = std::vector<double, NoInitAllocator<double>>;
+
+/** Description d'un bloc local de la matrice globale dim x dim :
+ *  lignes [start_row, start_row+nrows[ et colonnes [start_col, start_col+ncols[.
+ *  Le bloc est stocké par colonne (coefficient (i,j) en i + j*nrows) comme
+ *  les matrices locales de matvec_col.cpp et matvec_row.cpp.
+ **/
+struct BlockDescr
+{
+    int dim;
+    int start_row, nrows;
+    int start_col, ncols;
+};
+
+/** Tranche de lignes [beg,end[ qui revient au thread courant dans une
+ *  région parallèle. Premier contact, assemblage et produit passent tous
+ *  par cette fonction (plutôt que par un omp for) pour être certains
+ *  d'utiliser exactement la même répartition des lignes.
+ **/
+void threadRowRange( int nrows, int& beg, int& end );
+
+/** Premier contact parallèle avec les coefficients du bloc (mise à zéro)
+ *  avec la répartition des lignes de threadRowRange.
+ **/
+void firstTouchBlock( const BlockDescr& blk, double* coefs );
+
+/** Assemble en parallèle (OpenMP) le bloc blk de la matrice globale
+ *  A(I,J) = (I+J)%dim.
+ *
+ *  Chaque thread remplit toujours la même tranche de lignes de chaque
+ *  colonne (threadRowRange), ce qui fixe le placement mémoire par
+ *  premier contact. Le modulo n'est calculé qu'une fois par colonne et
+ *  par thread : on se contente ensuite d'incrémenter la valeur.
+ **/
+void assembleBlock( const BlockDescr& blk, double* coefs );
+
+/** Lecture collective (MPI-IO) du bloc blk dans un fichier binaire
+ *  contenant la matrice globale dim x dim en doubles stockés par colonne.
+ *
+ *  Chaque processus ne lit que son bloc (bloc ligne, bloc colonne ou bloc
+ *  2D selon blk) par un unique MPI_File_read_all sur une vue construite
+ *  avec MPI_Type_create_subarray.
+ **/
+void readBlock( MPI_Comm comm, const char* filename, const BlockDescr& blk, double* coefs );
+
+/** Écriture collective (MPI-IO) du bloc blk dans le fichier binaire de la
+ *  matrice globale. Sert surtout à générer le fichier lu par readBlock.
+ **/
+void writeBlock( MPI_Comm comm, const char* filename, const BlockDescr& blk, const double* coefs );
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _PALETTE_HPP_
+# define _PALETTE_HPP_
+
+/** Couleur (r,g,b) associée à un nombre d'itérations, pour toutes les
+ *  images écrites (savePicture, animation, anti-crénelage, serveur de
+ *  tuiles, version MPI). scaleCol vaut 1./maxIter : les trois composantes
+ *  suivent les chiffres successifs en base 256 de nbIter/maxIter.
+ **/
+inline void
+iterToColour( double scaleCol, int nbIter, unsigned char* rgb )
+{
+    double iter = scaleCol*nbIter;
+    rgb[0] = (unsigned char)(256 - (unsigned (iter*256.) & 0xFF));
+    rgb[1] = (unsigned char)(256 - (unsigned( iter*16777216) & 0xFF));
+    rgb[2] = (unsigned char)(256 - (unsigned (iter*65536) & 0xFF));
+}
+
+#endif
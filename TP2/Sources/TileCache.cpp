@@ -0,0 +1,181 @@
+# include <cmath>
+# include <cstdio>
+# include <fstream>
+# include <sstream>
+# include "MandelbrotKernel.hpp"
+# include "TileCache.hpp"
+
+TilePtr
+renderTile( const TileKey& key )
+{
+    const int n = tileSize*tileSize;
+    double span    = std::ldexp(3., -key.zoom);
+    double spacing = span/tileSize;
+    double x0 = -2.  + key.x*span;
+    double y0 = -1.5 + key.y*span;
+    std::vector<double> cre(n), cim(n);
+    for ( int i = 0; i < tileSize; ++i )
+        for ( int j = 0; j < tileSize; ++j ) {
+            cre[i*tileSize+j] = x0 + j*spacing;
+            cim[i*tileSize+j] = y0 + (tileSize-1-i)*spacing;
+        }
+    std::shared_ptr<std::vector<int>> tile = std::make_shared<std::vector<int>>(n);
+    iterMandelbrotPoints(key.maxIter, n, cre.data(), cim.data(), tile->data());
+    return tile;
+}
+// =====================================================================
+ThreadPool::ThreadPool( int nbThreads ) : m_stop(false)
+{
+    for ( int t = 0; t < nbThreads; ++t )
+        m_threads.emplace_back([this] () {
+            while ( true ) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_cond.wait(lock, [this] () { return m_stop || !m_jobs.empty(); });
+                    if ( m_jobs.empty() ) return;
+                    job = std::move(m_jobs.front());
+                    m_jobs.pop_front();
+                }
+                job();
+            }
+        });
+}
+// ---------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for ( auto& t : m_threads ) t.join();
+}
+// ---------------------------------------------------------------------
+void
+ThreadPool::submit( std::function<void()> job )
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_cond.notify_one();
+}
+// =====================================================================
+TileCache::TileCache( std::size_t capacity, const std::string& spillDir, ThreadPool& pool ) :
+    m_capacity(capacity < 1 ? 1 : capacity), m_spillDir(spillDir), m_pool(pool),
+    m_stats{0, 0, 0, 0, 0, 0, 0}
+{}
+// ---------------------------------------------------------------------
+TilePtr
+TileCache::get( const TileKey& key )
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_stats.requests += 1;
+    auto found = m_tiles.find(key);
+    if ( found != m_tiles.end() ) {
+        m_lru.splice(m_lru.begin(), m_lru, found->second.lruPos);
+        m_stats.memoryHits += 1;
+        return found->second.tile;
+    }
+    auto pending = m_pending.find(key);
+    if ( pending != m_pending.end() ) {
+        // Tuile déjà en cours de calcul : on attend le même résultat
+        m_stats.coalesced += 1;
+        std::shared_future<TilePtr> result = pending->second;
+        lock.unlock();
+        return result.get();
+    }
+    auto promise = std::make_shared<std::promise<TilePtr>>();
+    std::shared_future<TilePtr> result = promise->get_future().share();
+    m_pending[key] = result;
+    lock.unlock();
+    m_pool.submit([this, key, promise] () {
+        try {
+            TilePtr tile = loadSpilled(key);
+            bool fromDisk = bool(tile);
+            if ( !fromDisk ) tile = renderTile(key);
+            Evicted evicted;
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                evicted = insert(key, tile);
+                m_pending.erase(key);
+                if ( fromDisk ) m_stats.diskHits += 1;
+                else            m_stats.rendered += 1;
+            }
+            promise->set_value(tile);
+            for ( auto& e : evicted ) spill(e.first, e.second);
+        } catch ( ... ) {
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_pending.erase(key);
+            }
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return result.get();
+}
+// ---------------------------------------------------------------------
+TileCache::Stats
+TileCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats s = m_stats;
+    s.tilesInMemory = m_tiles.size();
+    return s;
+}
+// ---------------------------------------------------------------------
+TileCache::Evicted
+TileCache::insert( const TileKey& key, const TilePtr& tile )
+{
+    Evicted evicted;
+    if ( m_tiles.count(key) ) return evicted;
+    while ( m_tiles.size() >= m_capacity ) {
+        const TileKey& oldest = m_lru.back();
+        auto entry = m_tiles.find(oldest);
+        if ( !m_spillDir.empty() ) {
+            evicted.emplace_back(oldest, entry->second.tile);
+            m_stats.spilled += 1;
+        }
+        m_tiles.erase(entry);
+        m_lru.pop_back();
+    }
+    m_lru.push_front(key);
+    m_tiles[key] = Entry{tile, m_lru.begin()};
+    return evicted;
+}
+// ---------------------------------------------------------------------
+std::string
+TileCache::spillPath( const TileKey& key ) const
+{
+    std::ostringstream path;
+    path << m_spillDir << "/tile_" << key.zoom << '_' << key.x << '_' << key.y
+         << '_' << key.maxIter << ".bin";
+    return path.str();
+}
+// ---------------------------------------------------------------------
+TilePtr
+TileCache::loadSpilled( const TileKey& key ) const
+{
+    if ( m_spillDir.empty() ) return TilePtr();
+    std::ifstream ifs(spillPath(key).c_str(), std::ios::in | std::ios::binary);
+    if ( !ifs ) return TilePtr();
+    std::shared_ptr<std::vector<int>> tile = std::make_shared<std::vector<int>>(tileSize*tileSize);
+    ifs.read(reinterpret_cast<char*>(tile->data()), tile->size()*sizeof(int));
+    if ( ifs.gcount() != std::streamsize(tile->size()*sizeof(int)) ) return TilePtr();
+    return tile;
+}
+// ---------------------------------------------------------------------
+void
+TileCache::spill( const TileKey& key, const TilePtr& tile ) const
+{
+    // Écriture dans un fichier temporaire puis renommage : une lecture
+    // concurrente ne voit jamais de fichier incomplet
+    std::string path = spillPath(key), tmp = path + ".tmp";
+    {
+        std::ofstream ofs(tmp.c_str(), std::ios::out | std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(tile->data()), tile->size()*sizeof(int));
+        if ( !ofs ) return;
+    }
+    std::rename(tmp.c_str(), path.c_str());
+}
@@ -0,0 +1,114 @@
+#ifndef _TILE_CACHE_HPP_
+# define _TILE_CACHE_HPP_
+# include <condition_variable>
+# include <cstdint>
+# include <deque>
+# include <functional>
+# include <future>
+# include <list>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <unordered_map>
+# include <vector>
+
+/** Tuile carrée de tileSize x tileSize pixels. Au niveau de zoom z, la vue
+ *  [-2,1] x [-1.5,1.5] est découpée en 2^z x 2^z tuiles ; la tuile (x,y)
+ *  a son coin inférieur gauche en (-2 + 3x/2^z, -1.5 + 3y/2^z).
+ **/
+const int tileSize = 256;
+
+struct TileKey
+{
+    int zoom, x, y, maxIter;
+    bool operator == ( const TileKey& k ) const
+    {
+        return (zoom == k.zoom) && (x == k.x) && (y == k.y) && (maxIter == k.maxIter);
+    }
+};
+
+struct TileKeyHash
+{
+    std::size_t operator() ( const TileKey& k ) const
+    {
+        std::uint64_t h = std::uint64_t(k.zoom);
+        h = h*0x9E3779B97F4A7C15ULL + std::uint64_t(k.x);
+        h = h*0x9E3779B97F4A7C15ULL + std::uint64_t(k.y);
+        h = h*0x9E3779B97F4A7C15ULL + std::uint64_t(k.maxIter);
+        return std::size_t(h ^ (h >> 32));
+    }
+};
+
+/** Nombres d'itérations d'une tuile, ligne 0 en haut (comme les images) */
+typedef std::shared_ptr<const std::vector<int>> TilePtr;
+
+/** Calcule les nombres d'itérations de la tuile key */
+TilePtr renderTile( const TileKey& key );
+
+/** Réservoir de threads de taille fixe exécutant des tâches dans l'ordre
+ *  où elles sont soumises.
+ **/
+class ThreadPool
+{
+public:
+    ThreadPool( int nbThreads );
+    ~ThreadPool();
+    void submit( std::function<void()> job );
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stop;
+};
+
+/** Cache LRU de tuiles en mémoire, avec débordement optionnel sur disque.
+ *
+ *  get renvoie la tuile depuis la mémoire, sinon depuis le disque, sinon
+ *  la fait calculer par le réservoir de threads. Plusieurs demandes
+ *  simultanées de la même tuile absente sont regroupées : une seule la
+ *  calcule, les autres attendent le même résultat (shared_future).
+ *  Les tuiles chassées de la mémoire sont écrites dans spillDir (si non
+ *  vide) et y sont relues au besoin.
+ **/
+class TileCache
+{
+public:
+    struct Stats
+    {
+        long requests, memoryHits, diskHits, coalesced, rendered, spilled;
+        std::size_t tilesInMemory;
+    };
+
+    TileCache( std::size_t capacity, const std::string& spillDir, ThreadPool& pool );
+
+    TilePtr get( const TileKey& key );
+    Stats   stats() const;
+private:
+    typedef std::list<TileKey> LruList;
+    struct Entry
+    {
+        TilePtr tile;
+        LruList::iterator lruPos;
+    };
+
+    typedef std::vector<std::pair<TileKey,TilePtr>> Evicted;
+    // Appelée avec m_mutex verrouillé ; renvoie les tuiles chassées, à
+    // écrire sur disque une fois le verrou relâché
+    Evicted     insert( const TileKey& key, const TilePtr& tile );
+    std::string spillPath( const TileKey& key ) const;
+    TilePtr     loadSpilled( const TileKey& key ) const;
+    void        spill( const TileKey& key, const TilePtr& tile ) const;
+
+    std::size_t m_capacity;
+    std::string m_spillDir;
+    ThreadPool& m_pool;
+    mutable std::mutex m_mutex;
+    LruList m_lru; // Plus récemment utilisée en tête
+    std::unordered_map<TileKey, Entry, TileKeyHash> m_tiles;
+    std::unordered_map<TileKey, std::shared_future<TilePtr>, TileKeyHash> m_pending;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,214 @@
+# include <iostream>
+# include <cstdlib>
+# include <string>
+# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <vector>
+# include <algorithm>
+# include <mutex>
+# include <sstream>
+# include <thread>
+# include <unistd.h>
+# include <netinet/in.h>
+# include <arpa/inet.h>
+# include <sys/socket.h>
+# include "MandelbrotKernel.hpp"
+# include "TileCache.hpp"
+# include "Palette.hpp"
+
+/** Serveur local de tuiles pour un visualiseur interactif (HTTP sur
+ *  127.0.0.1, une connexion par requête) :
+ *
+ *      GET /tile/z/x/y/maxIter.ppm : tuile en couleurs (palette de
+ *                                    Palette.hpp) ;
+ *      GET /tile/z/x/y/maxIter.raw : nombres d'itérations bruts (int32) ;
+ *      GET /stats                  : taux de succès du cache, latences
+ *                                    p50/p99 des tuiles.
+ *
+ *  Usage : ./TileServer.exe [port] [tuiles en mémoire] [répertoire de débordement] [threads]
+ *  puis par exemple : curl -o t.ppm http://127.0.0.1:8080/tile/3/2/4/4096.ppm
+ **/
+
+namespace {
+    // Au-delà, l'écart entre deux pixels n'est plus représentable en double
+    const int maxZoom = 40;
+    // Seuil d'itérations maximal d'une tuile : au-delà, une seule requête
+    // occuperait un thread de connexion presque sans fin (et le cache)
+    const int maxTileIter = 1 << 20;
+
+    /* Latences des dernières requêtes de tuiles, en millisecondes */
+    class LatencyLog
+    {
+    public:
+        void add( double ms )
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if ( m_samples.size() < maxSamples ) m_samples.push_back(ms);
+            else m_samples[m_next] = ms;
+            m_next = (m_next + 1) % maxSamples;
+        }
+        /* Centile q (entre 0 et 1) des latences mesurées */
+        double percentile( double q ) const
+        {
+            std::vector<double> s;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                s = m_samples;
+            }
+            if ( s.empty() ) return 0.;
+            std::size_t k = std::min(s.size()-1, std::size_t(q*s.size()));
+            std::nth_element(s.begin(), s.begin()+k, s.end());
+            return s[k];
+        }
+    private:
+        static const std::size_t maxSamples = 100000;
+        mutable std::mutex m_mutex;
+        std::vector<double> m_samples;
+        std::size_t m_next = 0;
+    };
+
+    void sendAll( int fd, const std::string& data )
+    {
+        std::size_t sent = 0;
+        while ( sent < data.size() ) {
+            ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if ( n <= 0 ) return;
+            sent += std::size_t(n);
+        }
+    }
+
+    void reply( int fd, int status, const std::string& type, const std::string& body )
+    {
+        std::ostringstream header;
+        header << "HTTP/1.0 " << status << ( status == 200 ? " OK" : ( status == 404 ? " Not Found"
+                                                                              : " Bad Request" ) )
+               << "\r\nContent-Type: " << type
+               << "\r\nContent-Length: " << body.size()
+               << "\r\nConnection: close\r\n\r\n";
+        sendAll(fd, header.str());
+        sendAll(fd, body);
+    }
+
+    std::string tileToPPM( const std::vector<int>& tile, int maxIter )
+    {
+        std::ostringstream ppm;
+        ppm << "P6\n" << tileSize << " " << tileSize << "\n255\n";
+        std::string out = ppm.str();
+        double scaleCol = 1./maxIter;
+        for ( int nbIter : tile ) {
+            unsigned char rgb[3];
+            iterToColour(scaleCol, nbIter, rgb);
+            out.append(reinterpret_cast<const char*>(rgb), 3);
+        }
+        return out;
+    }
+
+    /* Analyse "/tile/z/x/y/maxIter.ext" ; faux si le chemin est invalide */
+    bool parseTilePath( const std::string& path, TileKey& key, std::string& ext )
+    {
+        char extension[8] = { 0 };
+        int consumed = 0;
+        if ( std::sscanf(path.c_str(), "/tile/%d/%d/%d/%d.%7[a-z]%n", &key.zoom, &key.x, &key.y,
+                         &key.maxIter, extension, &consumed) != 5 ) return false;
+        if ( std::size_t(consumed) != path.size() ) return false;
+        ext = extension;
+        if ( (ext != "ppm") && (ext != "raw") ) return false;
+        if ( (key.zoom < 0) || (key.zoom > maxZoom) || (key.maxIter < 1) || (key.maxIter > maxTileIter) )
+            return false;
+        long nbTiles = 1L << key.zoom;
+        return (key.x >= 0) && (key.x < nbTiles) && (key.y >= 0) && (key.y < nbTiles);
+    }
+
+    void handleConnection( int fd, TileCache& cache, LatencyLog& latencies )
+    {
+        // Lecture de l'en-tête de la requête (seule la première ligne sert)
+        std::string request;
+        char buffer[1024];
+        while ( request.find("\r\n\r\n") == std::string::npos && request.size() < 8192 ) {
+            ssize_t n = ::recv(fd, buffer, sizeof(buffer), 0);
+            if ( n <= 0 ) break;
+            request.append(buffer, std::size_t(n));
+        }
+        std::istringstream firstLine(request.substr(0, request.find("\r\n")));
+        std::string method, path;
+        firstLine >> method >> path;
+        TileKey key;
+        std::string ext;
+        if ( method != "GET" )
+            reply(fd, 400, "text/plain", "Seules les requetes GET sont acceptees\n");
+        else if ( path == "/stats" ) {
+            TileCache::Stats s = cache.stats();
+            double hitRate = ( s.requests > 0 ? 100.*(s.memoryHits + s.diskHits + s.coalesced)/s.requests
+                                              : 0. );
+            std::ostringstream out;
+            out << "requetes : " << s.requests << "\n"
+                << "succes memoire : " << s.memoryHits << "\n"
+                << "succes disque : " << s.diskHits << "\n"
+                << "regroupees : " << s.coalesced << "\n"
+                << "calculees : " << s.rendered << "\n"
+                << "ecrites sur disque : " << s.spilled << "\n"
+                << "tuiles en memoire : " << s.tilesInMemory << "\n"
+                << "taux de succes (memoire, disque ou regroupee) : " << hitRate << " %\n"
+                << "latence p50 : " << latencies.percentile(0.50) << " ms\n"
+                << "latence p99 : " << latencies.percentile(0.99) << " ms\n";
+            reply(fd, 200, "text/plain", out.str());
+        }
+        else if ( parseTilePath(path, key, ext) ) {
+            std::chrono::time_point<std::chrono::steady_clock> start, end;
+            start = std::chrono::steady_clock::now();
+            TilePtr tile = cache.get(key);
+            std::string body;
+            if ( ext == "raw" )
+                body.assign(reinterpret_cast<const char*>(tile->data()), tile->size()*sizeof(int));
+            else
+                body = tileToPPM(*tile, key.maxIter);
+            end = std::chrono::steady_clock::now();
+            std::chrono::duration<double, std::milli> elapsed = end-start;
+            latencies.add(elapsed.count());
+            reply(fd, 200, ( ext == "raw" ? "application/octet-stream" : "image/x-portable-pixmap" ),
+                  body);
+        }
+        else
+            reply(fd, 404, "text/plain", "Chemin inconnu : /tile/z/x/y/maxIter.ppm|raw ou /stats\n");
+        ::close(fd);
+    }
+}
+
+int main( int argc, char* argv[] )
+{
+    int port = ( argc > 1 ? std::atoi(argv[1]) : 8080 );
+    std::size_t capacity = std::size_t( argc > 2 ? std::atol(argv[2]) : 1024 );
+    std::string spillDir = ( argc > 3 ? argv[3] : "" );
+    int nbThreads = ( argc > 4 ? std::atoi(argv[4]) : int(std::thread::hardware_concurrency()) );
+    if ( nbThreads < 1 ) nbThreads = 1;
+
+    int server = ::socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    ::setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(std::uint16_t(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ( (::bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) ||
+         (::listen(server, 64) < 0) ) {
+        std::cerr << "Impossible d'écouter sur le port " << port << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Noyau de calcul : " << simdKernelName(getSimdKernel()) << std::endl;
+    std::cout << "Serveur de tuiles sur http://127.0.0.1:" << port << " (" << capacity
+              << " tuiles en mémoire, " << nbThreads << " threads de calcul"
+              << ( spillDir.empty() ? "" : ", débordement dans " + spillDir ) << ")" << std::endl;
+
+    ThreadPool pool(nbThreads);
+    TileCache cache(capacity, spillDir, pool);
+    LatencyLog latencies;
+    while ( true ) {
+        int fd = ::accept(server, nullptr, nullptr);
+        if ( fd < 0 ) continue;
+        // Un thread léger par connexion : il ne fait qu'attendre la tuile,
+        // le calcul lui-même est fait par le réservoir de threads
+        std::thread(handleConnection, fd, std::ref(cache), std::ref(latencies)).detach();
+    }
+    return EXIT_SUCCESS;
+}
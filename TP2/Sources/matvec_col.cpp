@@ -2,7 +2,10 @@
 # include <cassert>
 # include <vector>
 # include <iostream>
+# include <chrono>
+# include <string>
 # include <mpi.h>
+# include "MatrixAssembly.hpp"
 
 // ---------------------------------------------------------------------
 class Matrix : public std::vector<double>
@@ -16,6 +19,10 @@ public:
      *  construit
      */
     Matrix( int nrows, int ncols, int start=0 );
+    /** @brief Lit le bloc colonne nrows x ncols (même convention pour start)
+     *  dans le fichier binaire filename contenant toute la matrice (MPI-IO)
+     */
+    Matrix( MPI_Comm comm, const std::string& filename, int nrows, int ncols, int start=0 );
     Matrix( const Matrix& A ) = delete;
     Matrix( Matrix&& A ) = default;
     ~Matrix() = default;
@@ -30,6 +37,8 @@ public:
         return m_arr_coefs[i + j*m_nrows];
     }
     
+    const double* coefs() const { return m_arr_coefs.data(); }
+
     std::vector<double> operator * ( const std::vector<double>& u ) const;
     
     std::ostream& print( std::ostream& out ) const
@@ -48,7 +57,7 @@ public:
     }
 private:
     int m_nrows, m_ncols;
-    std::vector<double> m_arr_coefs;
+    CoefsArray m_arr_coefs;
 };
 // ---------------------------------------------------------------------
 inline std::ostream& 
@@ -73,10 +82,17 @@ Matrix::operator * ( const std::vector<double>& u ) const
     const Matrix& A = *this;
     assert( u.size() == unsigned(m_ncols) );
     std::vector<double> v(m_nrows, 0.);
-    for ( int i = 0; i < m_nrows; ++i ) {
+    // Chaque thread relit la tranche de lignes qu'il a lui-même assemblée
+    // (premier contact), en parcourant les colonnes de façon contigüe.
+#   pragma omp parallel
+    {
+        int beg, end;
+        threadRowRange(m_nrows, beg, end);
         for ( int j = 0; j < m_ncols; ++j ) {
-            v[i] += A(i,j)*u[j];
-        }            
+            for ( int i = beg; i < end; ++i ) {
+                v[i] += A(i,j)*u[j];
+            }
+        }
     }
     return v;
 }
@@ -96,20 +112,28 @@ Matrix::Matrix( int nrows, int ncols, int start ) : m_nrows(nrows), m_ncols(ncol
                                                     m_arr_coefs(nrows*ncols)
 {
     int dim = (nrows > ncols ? nrows : ncols );
-    for ( int i = 0; i < nrows; ++ i ) {
-        for ( int j = 0; j < ncols; ++j ) {
-            (*this)(i,j) = (i+j+start)%dim;
-        }
-    }    
+    assembleBlock({dim, 0, nrows, start, ncols}, m_arr_coefs.data());
+}
+// ---------------------------------------------------------------------
+Matrix::Matrix( MPI_Comm comm, const std::string& filename, int nrows, int ncols, int start ) :
+    m_nrows(nrows), m_ncols(ncols), m_arr_coefs(std::size_t(nrows)*ncols)
+{
+    int dim = (nrows > ncols ? nrows : ncols );
+    BlockDescr blk{dim, 0, nrows, start, ncols};
+    // Premier contact par les threads avant que MPI ne remplisse le bloc
+    firstTouchBlock(blk, m_arr_coefs.data());
+    readBlock(comm, filename.c_str(), blk, m_arr_coefs.data());
 }
 // =====================================================================
 int main( int nargs, char* argv[] )
 {
     const int N = 12000;
     MPI_Init(&nargs, &argv);
+    MPI_Comm globComm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &globComm);
     int rank, nbp;
-    MPI_Comm_size(MPI_COMM_WORLD,&nbp);
-    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    MPI_Comm_size(globComm,&nbp);
+    MPI_Comm_rank(globComm,&rank);
     // On va assemble qu'un bloc colonne de la matrice par processus
     // Le processus de rang rank, assemble les colonnes qui vont
     // de (N/nbp)*rank à (N/nb)*(rank+1) (non compris)
@@ -132,7 +156,31 @@ int main( int nargs, char* argv[] )
      *     ncols = 3 + 0 = 3 colonnes
      *     start = rank*ncols + 1 = 4 <== Je commence à la 5e colonne de la matrice globale
      */
-    Matrix Aloc(N, ncols, start);
+    /* Sans argument, on assemble la matrice locale. Avec "-w fichier", on
+     * l'assemble puis on sauve la matrice globale dans fichier (MPI-IO).
+     * Avec "-r fichier", on lit uniquement notre bloc dans fichier.
+     */
+    std::string mode, filename;
+    if ( nargs > 2 ) {
+        mode     = argv[1];
+        filename = argv[2];
+    }
+    std::chrono::time_point<std::chrono::system_clock> t_start, t_end;
+    std::chrono::duration<double> elapsed_seconds;
+    t_start = std::chrono::system_clock::now();
+    Matrix Aloc = ( mode == "-r" ? Matrix(globComm, filename, N, ncols, start)
+                                 : Matrix(N, ncols, start) );
+    t_end = std::chrono::system_clock::now();
+    elapsed_seconds = t_end - t_start;
+    double t_build = elapsed_seconds.count();
+    if ( mode == "-w" ) {
+        t_start = std::chrono::system_clock::now();
+        writeBlock(globComm, filename.c_str(), {N, 0, N, start, ncols}, Aloc.coefs());
+        t_end = std::chrono::system_clock::now();
+        elapsed_seconds = t_end - t_start;
+        if ( rank == 0 )
+            std::cout << "Temps écriture matrice : " << elapsed_seconds.count() << std::endl;
+    }
     //Matrix A(N);
     //std::cout  << "Aloc : " << Aloc << std::endl;
     /** Pas besoin d'assembler tout le vecteur. On va assembler uniquement 
@@ -146,9 +194,21 @@ int main( int nargs, char* argv[] )
     //      nbp
     // v = sum( A_loc(i)*u_loc(i) )
     //     i=1
+    t_start = std::chrono::system_clock::now();
     std::vector<double> v_loc = Aloc * u_loc;
     std::vector<double> v_glob(N,0.);
-    MPI_Allreduce(v_loc.data(), v_glob.data(), N, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(v_loc.data(), v_glob.data(), N, MPI_DOUBLE, MPI_SUM, globComm);
+    t_end = std::chrono::system_clock::now();
+    elapsed_seconds = t_end - t_start;
+    double t_prod = elapsed_seconds.count();
+    // On affiche les temps du processus le plus lent
+    double t_loc[2] = { t_build, t_prod }, t_max[2];
+    MPI_Reduce(t_loc, t_max, 2, MPI_DOUBLE, MPI_MAX, 0, globComm);
+    if ( rank == 0 ) {
+        std::cout << ( mode == "-r" ? "Temps lecture MPI-IO matrice : " : "Temps assemblage matrice : " )
+                  << t_max[0] << std::endl;
+        std::cout << "Temps produit matrice-vecteur : " << t_max[1] << std::endl;
+    }
   
     //std::cout << "A.u = " << v_glob << std::endl;
     MPI_Finalize();
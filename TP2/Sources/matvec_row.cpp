@@ -2,7 +2,10 @@
 # include <cassert>
 # include <vector>
 # include <iostream>
+# include <chrono>
+# include <string>
 # include <mpi.h>
+# include "MatrixAssembly.hpp"
 
 // ---------------------------------------------------------------------
 class Matrix : public std::vector<double>
@@ -10,6 +13,10 @@ class Matrix : public std::vector<double>
 public:
     Matrix (int dim);
     Matrix( int nrows, int start_row, int ncols );
+    /** @brief Lit le bloc ligne nrows x ncols débutant à la ligne start_row
+     *  dans le fichier binaire filename contenant toute la matrice (MPI-IO)
+     */
+    Matrix( MPI_Comm comm, const std::string& filename, int nrows, int start_row, int ncols );
     Matrix( const Matrix& A ) = delete;
     Matrix( Matrix&& A ) = default;
     ~Matrix() = default;
@@ -24,6 +31,8 @@ public:
         return m_arr_coefs[i + j*m_nrows];
     }
     
+    const double* coefs() const { return m_arr_coefs.data(); }
+
     std::vector<double> operator * ( const std::vector<double>& u ) const;
     
     std::ostream& print( std::ostream& out ) const
@@ -42,7 +51,7 @@ public:
     }
 private:
     int m_nrows, m_ncols;
-    std::vector<double> m_arr_coefs;
+    CoefsArray m_arr_coefs;
 };
 // ---------------------------------------------------------------------
 inline std::ostream& 
@@ -67,10 +76,17 @@ Matrix::operator * ( const std::vector<double>& u ) const
     const Matrix& A = *this;
     assert( u.size() == unsigned(m_ncols) );
     std::vector<double> v(m_nrows, 0.);
-    for ( int i = 0; i < m_nrows; ++i ) {
+    // Chaque thread relit la tranche de lignes qu'il a lui-même assemblée
+    // (premier contact), en parcourant les colonnes de façon contigüe.
+#   pragma omp parallel
+    {
+        int beg, end;
+        threadRowRange(m_nrows, beg, end);
         for ( int j = 0; j < m_ncols; ++j ) {
-            v[i] += A(i,j)*u[j];
-        }            
+            for ( int i = beg; i < end; ++i ) {
+                v[i] += A(i,j)*u[j];
+            }
+        }
     }
     return v;
 }
@@ -90,24 +106,56 @@ Matrix::Matrix( int nrows, int start_row, int ncols ) : m_nrows(nrows), m_ncols(
                                                         m_arr_coefs(nrows*ncols)
 {
     int dim = (nrows > ncols ? nrows : ncols );
-    for ( int i = 0; i < nrows; ++ i ) {
-        for ( int j = 0; j < ncols; ++j ) {
-            (*this)(i,j) = (i+start_row+j)%dim;
-        }
-    }    
+    assembleBlock({dim, start_row, nrows, 0, ncols}, m_arr_coefs.data());
+}
+// ---------------------------------------------------------------------
+Matrix::Matrix( MPI_Comm comm, const std::string& filename, int nrows, int start_row, int ncols ) :
+    m_nrows(nrows), m_ncols(ncols), m_arr_coefs(std::size_t(nrows)*ncols)
+{
+    int dim = (nrows > ncols ? nrows : ncols );
+    BlockDescr blk{dim, start_row, nrows, 0, ncols};
+    // Premier contact par les threads avant que MPI ne remplisse le bloc
+    firstTouchBlock(blk, m_arr_coefs.data());
+    readBlock(comm, filename.c_str(), blk, m_arr_coefs.data());
 }
 // =====================================================================
 int main( int nargs, char* argv[] )
 {
     const int N = 12000;
     MPI_Init(&nargs, &argv);
+    MPI_Comm globComm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &globComm);
     int rank, nbp;
-    MPI_Comm_size(MPI_COMM_WORLD, &nbp);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(globComm, &nbp);
+    MPI_Comm_rank(globComm, &rank);
     // On suppose ici que le nombre de ligne est divisible par nbp
     int nrows = N/nbp;
     int start_row = rank*nrows;
-    Matrix Aloc(nrows, start_row, N);
+    /* Sans argument, on assemble la matrice locale. Avec "-w fichier", on
+     * l'assemble puis on sauve la matrice globale dans fichier (MPI-IO).
+     * Avec "-r fichier", on lit uniquement notre bloc dans fichier.
+     */
+    std::string mode, filename;
+    if ( nargs > 2 ) {
+        mode     = argv[1];
+        filename = argv[2];
+    }
+    std::chrono::time_point<std::chrono::system_clock> t_start, t_end;
+    std::chrono::duration<double> elapsed_seconds;
+    t_start = std::chrono::system_clock::now();
+    Matrix Aloc = ( mode == "-r" ? Matrix(globComm, filename, nrows, start_row, N)
+                                 : Matrix(nrows, start_row, N) );
+    t_end = std::chrono::system_clock::now();
+    elapsed_seconds = t_end - t_start;
+    double t_build = elapsed_seconds.count();
+    if ( mode == "-w" ) {
+        t_start = std::chrono::system_clock::now();
+        writeBlock(globComm, filename.c_str(), {N, start_row, nrows, 0, N}, Aloc.coefs());
+        t_end = std::chrono::system_clock::now();
+        elapsed_seconds = t_end - t_start;
+        if ( rank == 0 )
+            std::cout << "Temps écriture matrice : " << elapsed_seconds.count() << std::endl;
+    }
     //std::cout  << "Aloc : " << Aloc << std::endl;
     /** Ici, on a besoins de u entier sur chaque processus */
     std::vector<double> u( N );
@@ -116,10 +164,22 @@ int main( int nargs, char* argv[] )
     /* Ici, on a découpé la matrice A en ligne. Donc quand on fait :
      * Aloc*u on obtient un bout de v : v[start_row:start_row+nrows]
      */
+    t_start = std::chrono::system_clock::now();
     std::vector<double> v_loc = Aloc*u;
     //std::cout << "Aloc.u = " << v_loc << std::endl;
     std::vector<double> v(N);
-    MPI_Allgather(v_loc.data(), nrows, MPI_DOUBLE, v.data(), nrows, MPI_DOUBLE, MPI_COMM_WORLD);
+    MPI_Allgather(v_loc.data(), nrows, MPI_DOUBLE, v.data(), nrows, MPI_DOUBLE, globComm);
+    t_end = std::chrono::system_clock::now();
+    elapsed_seconds = t_end - t_start;
+    double t_prod = elapsed_seconds.count();
+    // On affiche les temps du processus le plus lent
+    double t_loc[2] = { t_build, t_prod }, t_max[2];
+    MPI_Reduce(t_loc, t_max, 2, MPI_DOUBLE, MPI_MAX, 0, globComm);
+    if ( rank == 0 ) {
+        std::cout << ( mode == "-r" ? "Temps lecture MPI-IO matrice : " : "Temps assemblage matrice : " )
+                  << t_max[0] << std::endl;
+        std::cout << "Temps produit matrice-vecteur : " << t_max[1] << std::endl;
+    }
     //std::cout << "A.u = " << v << std::endl;
     MPI_Finalize();
     return EXIT_SUCCESS;
@@ -0,0 +1,222 @@
+#ifndef _BITONIC_HPP_
+# define _BITONIC_HPP_
+# include <algorithm>
+# include <cstdint>
+# include <cstring>
+# include <limits>
+# include <utility>
+# include <vector>
+# include "Vecteur.hpp"
+
+// Tri Parallèle Bitonic
+//
+// Les deux moitiés de _sort et de _merge sont indépendantes : au-dessus de
+// cutoff éléments, la première moitié part dans une tâche OpenMP pendant
+// que le thread courant traite la seconde ; en dessous, la récursion est
+// séquentielle. Les longues passes de _compare sont de même découpées en
+// tranches de cutoff paires, une tâche par tranche.
+//
+// Pour les réels, les segments de blockLen éléments (nbLanes registres SIMD
+// de nbLanes réels : 64 en AVX-512, 16 en AVX) sont triés ou fusionnés en
+// registres par le réseau bitonique complet (min, max et permutations des
+// voies), au lieu de descendre la récursion jusqu'aux paires.
+# if defined(__AVX512F__)
+#   define BITONIC_SIMD_BYTES 64
+# elif defined(__AVX__)
+#   define BITONIC_SIMD_BYTES 32
+# else
+#   define BITONIC_SIMD_BYTES 16
+# endif
+namespace Bitonic
+{
+  const int defaultCutoff = 1 << 12;
+
+  typedef double DoubleLanes __attribute__((vector_size(BITONIC_SIMD_BYTES)));
+  typedef std::int64_t IndexLanes __attribute__((vector_size(BITONIC_SIMD_BYTES)));
+  const int nbLanes = BITONIC_SIMD_BYTES/8;
+  const int blockLen = nbLanes*nbLanes;
+
+  // Étape (k, j) du réseau bitonique sur les blockLen réels de v, dans
+  // l'ordre de la mémoire (élément e : registre e/nbLanes, voie
+  // e%nbLanes) : e et e^j sont comparés, croissants si e&k est nul. Toutes
+  // les directions sont inversées pour un tri décroissant.
+  inline void _networkStep( bool up, DoubleLanes* v, int k, int j )
+  {
+    IndexLanes lane;
+    for ( int l = 0; l < nbLanes; ++l ) lane[l] = l;
+    if ( j >= nbLanes ) {
+      // Partenaire dans un autre registre
+      const int jr = j/nbLanes;
+      for ( int r = 0; r < nbLanes; ++r ) {
+        if ( r & jr ) continue;
+        IndexLanes asc = ((r*nbLanes + lane) & k) == 0;
+        if ( !up ) asc = ~asc;
+        DoubleLanes a = v[r], b = v[r+jr];
+        IndexLanes swapped = b < a;
+        DoubleLanes mn = swapped ? b : a, mx = swapped ? a : b;
+        v[r]    = asc ? mn : mx;
+        v[r+jr] = asc ? mx : mn;
+      }
+    } else {
+      // Partenaire dans le même registre : permutation des voies
+      const IndexLanes partner = lane ^ j;
+      const IndexLanes lower = (lane & j) == 0;
+      for ( int r = 0; r < nbLanes; ++r ) {
+        IndexLanes asc = ((r*nbLanes + lane) & k) == 0;
+        if ( !up ) asc = ~asc;
+        DoubleLanes a = v[r], b = __builtin_shuffle(a, partner);
+        IndexLanes swapped = b < a;
+        DoubleLanes mn = swapped ? b : a, mx = swapped ? a : b;
+        v[r] = (lower == asc) ? mn : mx;
+      }
+    }
+  }
+  // --------------------------------------------
+  // Tri (merge = false) ou fusion d'une suite bitonique (merge = true) de
+  // blockLen réels en registres ; faux si len n'est pas blockLen
+  inline bool _network( bool up, double* objs, int len, bool merge )
+  {
+    if ( len != blockLen ) return false;
+    DoubleLanes v[nbLanes];
+    std::memcpy(v, objs, sizeof(v));
+    for ( int k = ( merge ? blockLen : 2 ); k <= blockLen; k *= 2 )
+      for ( int j = k/2; j > 0; j /= 2 )
+        _networkStep(up, v, k, j);
+    std::memcpy(objs, v, sizeof(v));
+    return true;
+  }
+  template<typename Obj>
+  bool _network( bool, Obj*, int, bool ) { return false; }
+
+  template<typename Obj>
+  void _compareRange( bool up, Obj* objs, int dist, int begin, int end )
+  {
+    for ( int i = begin; i < end; ++i ) {
+      if ( (objs[i] > objs[i+dist]) == up ) {
+	std::swap(objs[i],objs[i+dist]);
+      }
+    }
+  }
+  // Réels : min et max sans branchement, la boucle se vectorise
+  inline void _compareRange( bool up, double* objs, int dist, int begin, int end )
+  {
+    double* lo = ( up ? objs : objs + dist );
+    double* hi = ( up ? objs + dist : objs );
+#   pragma omp simd
+    for ( int i = begin; i < end; ++i ) {
+      double a = lo[i], b = hi[i];
+      lo[i] = std::min(a,b);
+      hi[i] = std::max(a,b);
+    }
+  }
+  // --------------------------------------------
+  template<typename Obj>
+  void _compare( bool up, Obj* objs, int len, int cutoff )
+  {
+    int dist = len/2;
+    if ( dist <= cutoff ) {
+      _compareRange(up, objs, dist, 0, dist);
+      return;
+    }
+    int nbChunks = (dist + cutoff - 1)/cutoff;
+#   pragma omp taskloop grainsize(1)
+    for ( int c = 0; c < nbChunks; ++c )
+      _compareRange(up, objs, dist, c*cutoff, std::min(dist, (c+1)*cutoff));
+  }
+  // --------------------------------------------
+  template<typename Obj>
+  void _merge( bool up, Obj* objs, int len, int cutoff, bool network )
+  {
+    if (len <= 1) return;
+    if ( network && _network(up, objs, len, true) ) return;
+    _compare(up,objs,len,cutoff);
+    if ( len > cutoff ) {
+#     pragma omp task
+      _merge(up, objs, len/2, cutoff, network);
+      _merge(up, objs+len/2, len-(len/2), cutoff, network);
+#     pragma omp taskwait
+    } else {
+      _merge(up, objs, len/2, cutoff, network);
+      _merge(up, objs+len/2, len-(len/2), cutoff, network);
+    }
+  }
+  // --------------------------------------------
+  template<typename Obj>
+  void _sort( bool up, Obj* objs, int len, int cutoff, bool network )
+  {
+    if (len <= 1) return;
+    if ( network && _network(up, objs, len, false) ) return;
+    if ( len > cutoff ) {
+#     pragma omp task
+      _sort(true , objs, len/2, cutoff, network);
+      _sort(false, objs + len/2, len - (len/2), cutoff, network);
+#     pragma omp taskwait
+    } else {
+      _sort(true , objs, len/2, cutoff, network);
+      _sort(false, objs + len/2, len - (len/2), cutoff, network);
+    }
+    _merge(up, objs, len, cutoff, network);
+  }
+  // --------------------------------------------
+  /** Trie x (longueur puissance de deux) ; les segments d'au plus cutoff
+   *  éléments sont triés sans tâche (cutoff >= x.size() : tri séquentiel).
+   *  network = false garde la récursion scalaire jusqu'au bout pour les
+   *  réels (comparaison avec le réseau SIMD). */
+  template<typename Obj> std::vector<Obj>&
+  sort( bool up, std::vector<Obj>& x, int cutoff = defaultCutoff, bool network = true )
+  {
+#   pragma omp parallel
+#   pragma omp single
+    _sort(up, x.data(), int(x.size()), cutoff, network);
+    return x;
+  }  
+  // --------------------------------------------
+  // Clé de tri d'un vecteur : sa norme, puis son rang dans la collection
+  struct NormKey
+  {
+    double norm;
+    std::uint64_t index;
+    bool operator > ( const NormKey& k ) const
+    {
+      return (norm > k.norm) || ((norm == k.norm) && (index > k.index));
+    }
+  };
+  /** Trie des vecteurs par leurs clés : chaque norme n'est calculée qu'une
+   *  fois, les clés (16 octets) sont triées par le tri bitonique à tâches
+   *  (complétées jusqu'à une puissance de deux), puis les vecteurs sont
+   *  déplacés une seule fois. À normes égales (rare), operator< compare
+   *  les composantes : on les range dans l'ordre lexicographique (puis du
+   *  rang), qui respecte operator< partout où il définit un ordre. */
+  inline std::vector<Algebra::Vecteur>&
+  sortByKeys( bool up, std::vector<Algebra::Vecteur>& x, int cutoff = defaultCutoff )
+  {
+    const long n = long(x.size());
+    long len = 1;
+    while ( len < n ) len *= 2;
+    const double pad = ( up ? 1. : -1. )*std::numeric_limits<double>::infinity();
+    std::vector<NormKey> keys(len, NormKey{ pad, std::numeric_limits<std::uint64_t>::max() });
+#   pragma omp parallel for
+    for ( long i = 0; i < n; ++i ) keys[i] = NormKey{ x[i].norm(), std::uint64_t(i) };
+    sort(up, keys, cutoff);
+
+    auto lexOrder = [&x, up] ( const NormKey& a, const NormKey& b ) {
+      const Algebra::Vecteur& u = x[( up ? a : b ).index];
+      const Algebra::Vecteur& v = x[( up ? b : a ).index];
+      return std::lexicographical_compare(u.begin(), u.end(), v.begin(), v.end());
+    };
+    for ( long i = 0; i < n; ) {
+      long j = i + 1;
+      while ( (j < n) && (keys[j].norm == keys[i].norm) ) ++j;
+      if ( j - i > 1 ) std::stable_sort(keys.begin() + i, keys.begin() + j, lexOrder);
+      i = j;
+    }
+
+    std::vector<Algebra::Vecteur> sorted(n);
+#   pragma omp parallel for
+    for ( long i = 0; i < n; ++i ) sorted[i] = std::move(x[keys[i].index]);
+    x.swap(sorted);
+    return x;
+  }
+}
+
+#endif
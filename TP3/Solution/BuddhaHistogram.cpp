@@ -0,0 +1,50 @@
+# include "BuddhaHistogram.hpp"
+
+const char*
+histogramModeName( histogram_mode mode )
+{
+    switch(mode) {
+    case atomic_histogram : return "atomic";
+    case tiled_histogram  : return "tiled";
+    default               : return "private";
+    }
+}
+// ---------------------------------------------------------------------
+histogram_mode
+histogramModeFromName( const std::string& name )
+{
+    if ( name == "atomic" ) return atomic_histogram;
+    if ( name == "tiled"  ) return tiled_histogram;
+    return private_histogram;
+}
+// =====================================================================
+TiledHistogram::TiledHistogram( std::size_t size ) :
+    m_counts(size, 0),
+    m_locks((size + (std::size_t(1) << tileShift) - 1) >> tileShift)
+{
+    for ( omp_lock_t& lock : m_locks ) omp_init_lock(&lock);
+}
+// ---------------------------------------------------------------------
+TiledHistogram::~TiledHistogram()
+{
+    for ( omp_lock_t& lock : m_locks ) omp_destroy_lock(&lock);
+}
+// ---------------------------------------------------------------------
+void
+TiledHistogram::addHits( int tile, const std::vector<std::uint32_t>& hits )
+{
+    Count* counts = m_counts.data();
+    omp_set_lock(&m_locks[tile]);
+    for ( std::uint32_t ind : hits ) counts[ind] += 1;
+    omp_unset_lock(&m_locks[tile]);
+}
+// ---------------------------------------------------------------------
+void
+TiledAccumulator::flush()
+{
+    for ( int tile = 0; tile < int(m_pending.size()); ++tile ) {
+        if ( m_pending[tile].empty() ) continue;
+        m_histogram.addHits(tile, m_pending[tile]);
+        m_pending[tile].clear();
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef _BUDDHA_HISTOGRAM_HPP_
+# define _BUDDHA_HISTOGRAM_HPP_
+# include <cstdint>
+# include <string>
+# include <vector>
+# include <omp.h>
+
+/** Accumulation des orbites du Bhuddabrot.
+ *
+ *  Chaque point d'orbite incrémente une case de l'histogramme. Avec un
+ *  seul histogramme partagé et un "omp atomic" par incrément, tous les
+ *  threads se disputent les mêmes lignes de cache. Trois façons
+ *  d'accumuler, chacune représentée par un accumulateur propre à un
+ *  thread, d'interface add(ind) :
+ *    - atomic  : histogramme partagé, incréments atomiques (référence) ;
+ *    - private : un histogramme par thread, sans synchronisation, fusionnés
+ *                à la fin par une réduction en arbre parallèle. Mémoire :
+ *                un histogramme par thread ;
+ *    - tiled   : histogramme partagé découpé en tuiles de la taille d'un
+ *                cache ; chaque thread garde ses points par tuile dans une
+ *                liste et ne les ajoute que par paquets, sous le verrou de
+ *                la tuile. Mémoire : un seul histogramme, pour les très
+ *                grandes images.
+ *  Les compteurs sont sur 64 bits : pas de débordement même pour des
+ *  milliards de points par case.
+ **/
+typedef std::uint64_t Count;
+typedef std::vector<Count> Histogram;
+
+enum histogram_mode { atomic_histogram, private_histogram, tiled_histogram };
+const char* histogramModeName( histogram_mode mode );
+/** Inverse de histogramModeName (private_histogram pour un nom inconnu) */
+histogram_mode histogramModeFromName( const std::string& name );
+
+class AtomicAccumulator
+{
+public:
+    AtomicAccumulator( Histogram& image ) : m_image(image.data()) {}
+
+    void add( std::size_t ind )
+    {
+#       pragma omp atomic
+        m_image[ind] += 1;
+    }
+private:
+    Count* m_image;
+};
+
+class PrivateAccumulator
+{
+public:
+    /** image doit appartenir au thread (allouée par lui, de préférence,
+     *  pour qu'elle soit dans sa mémoire locale) */
+    PrivateAccumulator( Histogram& image ) : m_image(image.data()) {}
+
+    void add( std::size_t ind ) { m_image[ind] += 1; }
+private:
+    Count* m_image;
+};
+
+/** Histogramme partagé en tuiles protégées chacune par un verrou */
+class TiledHistogram
+{
+public:
+    static const int tileShift = 15; // 32768 compteurs, 256 Ko par tuile
+
+    TiledHistogram( std::size_t size );
+    ~TiledHistogram();
+    TiledHistogram( const TiledHistogram& ) = delete;
+    TiledHistogram& operator = ( const TiledHistogram& ) = delete;
+
+    int nbTiles() const { return int(m_locks.size()); }
+    /** Ajoute les points hits : indices globaux dans l'histogramme, tous
+     *  dans la tuile tile (ind >> tileShift == tile), dont on prend le verrou */
+    void addHits( int tile, const std::vector<std::uint32_t>& hits );
+    Histogram& counts() { return m_counts; }
+private:
+    Histogram m_counts;
+    std::vector<omp_lock_t> m_locks;
+};
+
+class TiledAccumulator
+{
+public:
+    static const std::size_t bufferSize = 1024; // Points gardés par tuile avant ajout
+
+    TiledAccumulator( TiledHistogram& histogram ) :
+        m_histogram(histogram), m_pending(histogram.nbTiles())
+    {}
+    TiledAccumulator( const TiledAccumulator& ) = delete;
+    TiledAccumulator& operator = ( const TiledAccumulator& ) = delete;
+    ~TiledAccumulator() { flush(); }
+
+    void add( std::size_t ind )
+    {
+        int tile = int(ind >> TiledHistogram::tileShift);
+        std::vector<std::uint32_t>& hits = m_pending[tile];
+        hits.push_back(std::uint32_t(ind));
+        if ( hits.size() == bufferSize ) {
+            m_histogram.addHits(tile, hits);
+            hits.clear();
+        }
+    }
+
+    /** Ajoute les points encore en attente */
+    void flush();
+private:
+    TiledHistogram& m_histogram;
+    std::vector<std::vector<std::uint32_t>> m_pending;
+};
+
+/** Somme des histogrammes dans histograms[0], par une réduction en arbre :
+ *  à l'étape s, histograms[t] += histograms[t + s] pour t multiple de 2s,
+ *  toutes les paires et tous les blocs de cases en parallèle. Les
+ *  histogrammes ajoutés sont libérés au fur et à mesure. Value : Count,
+ *  ou double pour les histogrammes pondérés.
+ **/
+template<typename Value>
+void treeReduce( std::vector<std::vector<Value>>& histograms )
+{
+    const int nbHists = int(histograms.size());
+    if ( nbHists == 0 ) return;
+    const long size = long(histograms[0].size());
+    const long blockSize = 1L << 14;
+    const long nbBlocks = (size + blockSize - 1)/blockSize;
+    for ( int stride = 1; stride < nbHists; stride *= 2 ) {
+        const int nbPairs = (nbHists - stride + 2*stride - 1)/(2*stride);
+#       pragma omp parallel for collapse(2) schedule(static)
+        for ( int p = 0; p < nbPairs; ++p )
+            for ( long b = 0; b < nbBlocks; ++b ) {
+                Value* dst = histograms[2*stride*p].data();
+                const Value* src = histograms[2*stride*p + stride].data();
+                const long end = ( size < (b+1)*blockSize ? size : (b+1)*blockSize );
+                for ( long k = b*blockSize; k < end; ++k ) dst[k] += src[k];
+            }
+        for ( int p = 0; p < nbPairs; ++p ) std::vector<Value>().swap(histograms[2*stride*p + stride]);
+    }
+}
+
+#endif
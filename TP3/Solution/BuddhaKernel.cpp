@@ -0,0 +1,149 @@
+# include <algorithm>
+# include <cmath>
+# include <fstream>
+# include "BuddhaKernel.hpp"
+
+const InteriorMask* interiorMask = nullptr;
+bool useSymmetry = true;
+
+// =====================================================================
+/* Les tests de zones connues et d'échappement sont compilés sans
+ * contraction en FMA, ici et dans bhudda.cpp (in_known_convergence_zones,
+ * escape_iterations_simd) : le compilateur ne fusionne pas les mêmes
+ * opérations en scalaire et en vectoriel, et un point tout près d'un bord
+ * (ou une orbite chaotique qui dépend de l'arrondi) serait classé
+ * différemment selon la version (et donc, pour la version vectorielle,
+ * selon que la voie finit en scalaire ou non, donc selon le nombre de
+ * threads).
+ */
+# pragma GCC push_options
+# pragma GCC optimize("fp-contract=off")
+bool in_known_convergence_zone( const Complex& c )
+{
+    // On vérifie dans un premier temps si le complexe
+    // n'appartient pas à une zone de convergence connue :
+    // Appartenance aux disques  C0{(0,0),1/4} et C1{(-1,0),1/4}
+    if ( c.re*c.re+c.im*c.im < 0.0625 )
+        return true;
+    if ( (c.re+1)*(c.re+1)+c.im*c.im < 0.0625 )
+        return true;
+    // Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))} :
+    // |ct| < (1 - ct.re/|ct|)/2  <=>  2|ct|² + ct.re < |ct|, sans racine ni
+    // division, en float comme in_known_convergence_zones (bhudda.cpp) pour
+    // classer les points du bord de la même façon
+    if ((c.re > -0.75f) && (c.re < 0.5f) ) {
+        float x = c.re - 0.25f, q2 = x*x + c.im*c.im, a = 2.f*q2 + x;
+        if ( (a < 0.f) || (a*a < q2) ) return true;
+    }
+    // Disques inscrits dans les bulbes de période 3 et 4 (voir
+    // isInKnownConvergenceZone dans TP2/Sources/MandelbrotKernel.cpp)
+    float ai = std::abs(c.im);
+    if ( (c.re+0.125f)*(c.re+0.125f)+(ai-0.744862f)*(ai-0.744862f) < 0.0915f*0.0915f )
+        return true;
+    if ( (c.re-0.28113f)*(c.re-0.28113f)+(ai-0.53120f)*(ai-0.53120f) < 0.0425f*0.0425f )
+        return true;
+    if ( (c.re+1.30919f)*(c.re+1.30919f)+c.im*c.im < 0.0575f*0.0575f )
+        return true;
+    if ( (c.re+1.75931f)*(c.re+1.75931f)+c.im*c.im < 0.0090f*0.0090f )
+        return true;
+    if ( interiorMask && interiorMask->contains(c.re, c.im) )
+        return true;
+    return false;
+}
+
+int continue_escape( int maxIter, Complex c, Complex z, Complex zsave, long checkpoint, int niter )
+{
+    while ((z.sqNorm() < 4.) && (niter < maxIter))
+    {
+        z = z*z + c;
+        ++niter;
+        if ( (z.re == zsave.re) && (z.im == zsave.im) )
+            return maxIter;
+        if ( niter == checkpoint ) {
+            zsave = z;
+            checkpoint *= 2;
+        }
+    }
+    return niter;
+}
+
+// ---------------------------------------------------------------------
+int escape_iteration( int maxIter, const Complex& c )
+{
+    if ( in_known_convergence_zone(c) )
+        return maxIter;
+    return continue_escape( maxIter, c, Complex(), Complex(), 1, 0 );
+}
+# pragma GCC pop_options
+// ---------------------------------------------------------------------
+bool test_mandelbrot_divergent( int maxIter, const Complex& c)
+{
+    return escape_iteration( maxIter, c ) < maxIter;
+}
+
+// ---------------------------------------------------------------------
+Complex disk_point( float u, float v )
+{
+    float r = 2.f*u;
+    float angle = 6.283185307179586f*v;
+    return Complex{ r * std::cos(angle), r * std::sin(angle) };
+}
+// ---------------------------------------------------------------------
+Complex draw_point( float u, float v )
+{
+    return disk_point( u, useSymmetry ? 0.5f*v : v );
+}
+// ---------------------------------------------------------------------
+Complex sample_point( const Philox4x32& philox, std::uint64_t iSample, std::uint64_t attempt )
+{
+    Philox4x32::Block b = philox.block(iSample, attempt);
+    return draw_point( Philox4x32::toFloat(b[0]), Philox4x32::toFloat(b[1]) );
+}
+// ---------------------------------------------------------------------
+std::vector<unsigned char>
+bhuddabrot_image( unsigned width, unsigned height, const std::vector<std::vector<double>>& layers )
+{
+    const std::vector<double>& buddha1 = layers[0];
+    const std::vector<double>& buddha2 = layers[1];
+    const std::vector<double>& buddha3 = layers[2];
+    std::vector<unsigned char> image(4*width*height);
+    double b1, b2, b3;
+    b1 = 0; b2 = 0; b3 = 0;
+#pragma omp parallel for collapse(2) reduction(+:b1,b2,b3)
+    for ( unsigned i = 0; i < height; ++i ) {
+        for (unsigned j = 0; j < width; ++j ) {
+            unsigned long ind = i*width+j;
+            b1 += buddha1[ind];
+            b2 += buddha2[ind];
+            b3 += buddha3[ind];
+        }
+    }
+    unsigned long stride = width*height;
+    float scal1 = ( b1 > 0 ? 16.*stride/b1 : 0. );
+    float scal2 = ( b2 > 0 ? 16.*stride/b2 : 0. );
+    float scal3 = ( b3 > 0 ? 16.*stride/b3 : 0. );
+#pragma omp parallel for collapse(2)
+    for ( unsigned i = 0; i < height; ++i ) {
+        for (unsigned j = 0; j < width; ++j ) {
+            unsigned long ind = i*width+j;
+            image[ 4*ind   ] = std::min(unsigned(buddha1[ind]*scal1),255U);
+            image[ 4*ind+1 ] = std::min(unsigned(buddha2[ind]*scal2),255U);
+            image[ 4*ind+2 ] = std::min(unsigned(buddha3[ind]*scal3),255U);
+            image[ 4*ind+3 ] = 255;
+        }
+    }    
+    return image;
+}
+// ---------------------------------------------------------------------
+void save_image( const std::string &filename, unsigned width, unsigned height, const std::vector<unsigned char> &img )
+{
+    std::ofstream ofs( filename.c_str(), std::ios::out | std::ios::binary );
+    ofs << "P6\n"
+        << width << " " << height << "\n255\n";
+    for ( unsigned i = 0; i < width * height; ++i ) {
+        ofs << img[ 4 * i + 0 ] << img[ 4 * i + 1 ] << img[ 4 * i + 2 ];
+    }
+    ofs.close();
+}
+
+
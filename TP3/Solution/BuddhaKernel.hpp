@@ -0,0 +1,128 @@
+#ifndef _BUDDHA_KERNEL_HPP_
+# define _BUDDHA_KERNEL_HPP_
+# include <cstddef>
+# include <cstdint>
+# include <string>
+# include <vector>
+# include "InteriorMask.hpp"
+# include "Philox.hpp"
+
+/** Noyau du Bhuddabrot commun à bhudda.cpp et bhudda_mpi.cpp : tirage des
+ *  points c, test d'échappement, dépôt des orbites et image finale.
+ **/
+struct Complex
+{
+    float re, im;    
+    Complex() : re(0.), im(0.)
+    {}
+    Complex(double r, double i) : re(r), im(i)
+    {}
+    double sqNorm() { return re*re + im*im; }
+    Complex operator + ( const Complex& z )
+    {
+        return Complex(re + z.re, im + z.im );
+    }
+    Complex operator * ( const Complex& z )
+    {
+        return Complex(re*z.re-im*z.im, re*z.im+im*z.re);
+    }
+
+
+};
+
+/* Détection de cycle (méthode de Brent) : on sauve z aux itérations 1, 2,
+ * 4, 8, ... et on compare chaque nouvel itéré au dernier z sauvé. L'itération
+ * en float est déterministe : si l'orbite retombe exactement sur ce point,
+ * elle boucle et ne divergera jamais. Une tolérance ne convient pas : près
+ * d'un point parabolique (c proche de 1/4), un pas d'une orbite qui finit
+ * par diverger peut être plus petit que n'importe quel seuil fixé.
+ */
+
+/* Options des tirages, fixées par les programmes :
+ *  - interiorMask : masque de l'intérieur (InteriorMask.hpp), qui rejette
+ *    en O(1) les c intérieurs que les tests de zones connues ne voient pas
+ *    (sinon itérés jusqu'à maxIter) ; aucun c qui diverge n'y est jamais ;
+ *  - useSymmetry : l'image est symétrique par rapport à l'axe réel (l'orbite
+ *    de conj(c) est la conjuguée de celle de c). On ne tire c que dans le
+ *    demi-disque im >= 0 et on dépose chaque orbite avec son symétrique :
+ *    un tirage compte pour deux, d'où deux fois moins d'orbites calculées.
+ */
+extern const InteriorMask* interiorMask;
+extern bool useSymmetry;
+
+// Vrai si c est dans une zone de convergence connue (ou dans le masque
+// intérieur) : inutile d'itérer
+bool in_known_convergence_zone( const Complex& c );
+// Suite de escape_iteration à partir de l'itéré z (niter itérations
+// faites, zsave sauvé, prochaine sauvegarde à checkpoint)
+int continue_escape( int maxIter, Complex c, Complex z, Complex zsave, long checkpoint, int niter );
+// Itération à laquelle l'orbite de c s'échappe du disque de rayon 2, ou
+// maxIter si elle ne diverge pas (ou pas en moins de maxIter itérations)
+int escape_iteration( int maxIter, const Complex& c );
+bool test_mandelbrot_divergent( int maxIter, const Complex& c);
+
+// Ajoute les points de l'orbite de c à l'histogramme, à travers
+// l'accumulateur du thread (voir BuddhaHistogram.hpp), et ceux de l'orbite
+// de conj(c) si mirror
+template<typename Accumulator>
+void comp_mandelbrot_orbit( int maxIter, const Complex& c, unsigned width, unsigned height, 
+                            Accumulator& image, bool mirror = false )
+{
+     int i = 0;
+     Complex z{0.,0.};
+     Complex z2{0.,0.};
+     while ( (z2.re+z2.im < float(4)) && (i<maxIter) )
+     {
+        z.im = float(2)*z.re*z.im + c.im;
+        z.re = z2.re - z2.im + c.re;
+        z2.re = z.re*z.re;
+        z2.im = z.im*z.im;
+        unsigned ip = unsigned((float(2)+z.im)*width/float(4));
+        unsigned jp = unsigned((float(2)+z.re)*height/float(4));
+        if ( (ip<width) && (jp<height) ) {
+           std::size_t ind = ip+std::size_t(jp)*width;
+           image.add(ind);
+        }
+        if ( mirror ) {
+           unsigned im = unsigned((float(2)-z.im)*width/float(4));
+           if ( (im<width) && (jp<height) ) image.add(im+std::size_t(jp)*width);
+        }
+        i ++;
+     }
+}
+
+// Point du disque de rayon 2, de rayon 2u et d'angle 2 pi v
+Complex disk_point( float u, float v );
+// Point c des tirages directs : dans tout le disque, ou dans le demi-disque
+// supérieur avec useSymmetry
+Complex draw_point( float u, float v );
+// Point c du tirage attempt de l'échantillon iSample : le bloc Philox de
+// compteur iSample dans le flot attempt. Il ne dépend que de la graine et
+// de iSample, pas du thread qui le tire.
+Complex sample_point( const Philox4x32& philox, std::uint64_t iSample, std::uint64_t attempt );
+
+// Échantillon iSample : tirages (flots attempt = 0, 1, ...) jusqu'au
+// premier c qui diverge en moins de maxIter itérations, dont l'orbite est
+// déposée dans acc. Renvoie le nombre de c testés.
+template<typename Accumulator>
+unsigned long sample_orbit( std::uint64_t iSample, unsigned long maxIter, unsigned width, unsigned height,
+                            const Philox4x32& philox, Accumulator& acc )
+{
+    std::uint64_t attempt = 0;
+    while ( true ) {
+        Complex c0 = sample_point( philox, iSample, attempt++ );
+        if ( test_mandelbrot_divergent( maxIter, c0 ) ) {
+            // Calcul de l'orbite si la suite diverge :
+            comp_mandelbrot_orbit( maxIter, c0, width, height, acc, useSymmetry );
+            return attempt;
+        }
+    }
+}
+
+/** Image RGBA des trois couches (rouge, vert, bleu), chacune normalisée
+ *  par sa moyenne **/
+std::vector<unsigned char> bhuddabrot_image( unsigned width, unsigned height,
+                                             const std::vector<std::vector<double>>& layers );
+void save_image( const std::string &filename, unsigned width, unsigned height, const std::vector<unsigned char> &img );
+
+#endif
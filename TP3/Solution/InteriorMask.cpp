@@ -0,0 +1,220 @@
+# include <chrono>
+# include <cmath>
+# include <complex>
+# include <fstream>
+# include <iostream>
+# include "InteriorMask.hpp"
+# include "Philox.hpp"
+
+constexpr double InteriorMask::reMin, InteriorMask::reMax, InteriorMask::imMax;
+constexpr int InteriorMask::defaultBuildIter;
+
+namespace {
+    typedef std::complex<double> complex;
+    const double safety = 0.9;     // Marge sur les rayons certifiés
+    const double cycleEps = 1.E-12;
+    const double escapeRadius = 1.E10;
+    // En-tête du fichier : "IMSK", puis la version du format, à changer
+    // dès que la disposition ou la méthode de construction change
+    const std::uint32_t fileMagic = 0x4B534D49;
+    const std::uint32_t fileVersion = 2;
+
+    template<typename T> void writeValue( std::ostream& output, T value )
+    {
+        output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    // Lit une valeur et vérifie qu'elle vaut expected
+    template<typename T> bool readValue( std::istream& input, T expected )
+    {
+        T value;
+        input.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return bool(input) && (value == expected);
+    }
+
+    // Distance intérieure b de c, de cycle attractif de période p passant
+    // (à peu près) par z. Négative si le cycle n'est pas attractif.
+    double interiorDistance( complex c, complex z, int p )
+    {
+        // Point du cycle affiné par la méthode de Newton sur f^p(z) - z
+        for ( int step = 0; step < 8; ++step ) {
+            complex w = z, dw = 1.;
+            for ( int k = 0; k < p; ++k ) { dw = 2.*w*dw; w = w*w + c; }
+            if ( dw == 1. ) break;
+            z -= (w - z)/(dw - 1.);
+        }
+        complex dz = 1., dzdz = 0., dc = 0., dcdz = 0.;
+        for ( int k = 0; k < p; ++k ) {
+            dcdz = 2.*(z*dcdz + dz*dc);
+            dc   = 2.*z*dc + 1.;
+            dzdz = 2.*(dz*dz + z*dzdz);
+            dz   = 2.*z*dz;
+            z    = z*z + c;
+        }
+        if ( std::norm(dz) >= 1. ) return -1.;
+        return (1. - std::norm(dz))/std::abs(dcdz + dzdz*dc/(1. - dz));
+    }
+
+    // Plus petite période q de p telle que f^q(z) = z (Brent trouve un
+    // multiple de la période, pour lequel la borne ne vaudrait plus)
+    int minimalPeriod( complex c, complex z, int p )
+    {
+        for ( int q = 1; q < p; ++q ) {
+            if ( p % q != 0 ) continue;
+            complex w = z;
+            for ( int k = 0; k < q; ++k ) w = w*w + c;
+            if ( std::abs(w - z) < 1.E3*cycleEps ) return q;
+        }
+        return p;
+    }
+
+    // +1 si le disque de centre c et de rayon radius est certainement dans
+    // l'ensemble, -1 s'il en est certainement hors, 0 sinon
+    int classify( complex c, double radius, int maxIter )
+    {
+        complex z = 0., dc = 0., zsave = 0.;
+        int saved = 0, checkpoint = 1;
+        for ( int n = 1; n <= maxIter; ++n ) {
+            dc = 2.*z*dc + 1.;
+            z  = z*z + c;
+            double r = std::abs(z);
+            if ( r > escapeRadius ) {
+                // Distance extérieure : au moins |z| ln|z| / (2 |dz/dc|)
+                double d = 0.5*r*std::log(r)/std::abs(dc);
+                return ( safety*d >= radius ? -1 : 0 );
+            }
+            if ( std::abs(z - zsave) < cycleEps ) {
+                int p = minimalPeriod(c, z, n - saved);
+                double b = interiorDistance(c, z, p);
+                return ( safety*0.25*b >= radius ? +1 : 0 );
+            }
+            if ( n == checkpoint ) {
+                zsave = z;
+                saved = n;
+                checkpoint *= 2;
+            }
+        }
+        return 0;
+    }
+}
+// =====================================================================
+InteriorMask::InteriorMask( int resolution ) :
+    m_nx(resolution), m_ny(0), m_wordsPerRow(resolution/64), m_buildIter(0),
+    m_h((reMax - reMin)/resolution), m_invH(resolution/(reMax - reMin)),
+    m_bits()
+{
+    m_ny = int(std::ceil(imMax*m_invH));
+    m_bits.assign(std::size_t(m_ny)*m_wordsPerRow, 0);
+}
+// ---------------------------------------------------------------------
+void
+InteriorMask::fillBlock( int i0, int j0, int size, int maxIter )
+{
+    if ( j0 >= m_ny ) return;
+    complex c( reMin + (i0 + 0.5*size)*m_h, (j0 + 0.5*size)*m_h );
+    int kind = classify(c, std::sqrt(0.5)*size*m_h, maxIter);
+    if ( kind > 0 ) {
+        for ( int j = j0; j < std::min(j0 + size, m_ny); ++j )
+            for ( int i = i0; i < i0 + size; ++i ) mark(i, j);
+    } else if ( (kind == 0) && (size > 1) ) {
+        int half = size/2;
+        fillBlock(i0,        j0,        half, maxIter);
+        fillBlock(i0 + half, j0,        half, maxIter);
+        fillBlock(i0,        j0 + half, half, maxIter);
+        fillBlock(i0 + half, j0 + half, half, maxIter);
+    }
+}
+// ---------------------------------------------------------------------
+void
+InteriorMask::build( int maxIter )
+{
+    // Blocs de 64 cellules de large : chacun a ses propres mots du masque
+    const int nbBlocksX = m_wordsPerRow, nbBlocksY = (m_ny + 63)/64;
+#   pragma omp parallel for collapse(2) schedule(dynamic)
+    for ( int by = 0; by < nbBlocksY; ++by )
+        for ( int bx = 0; bx < nbBlocksX; ++bx )
+            fillBlock(64*bx, 64*by, 64, maxIter);
+    m_buildIter = maxIter;
+}
+// ---------------------------------------------------------------------
+bool
+InteriorMask::load( const std::string& fileName, int maxIter )
+{
+    std::ifstream input(fileName.c_str(), std::ios::binary);
+    if ( !input ) return false;
+    // Mêmes champs et même ordre que save ; on s'arrête au premier écart
+    bool same = readValue(input, fileMagic) && readValue(input, fileVersion)
+             && readValue(input, m_nx) && readValue(input, m_ny) && readValue(input, maxIter)
+             && readValue(input, reMin) && readValue(input, reMax) && readValue(input, imMax)
+             && readValue(input, safety) && readValue(input, cycleEps) && readValue(input, escapeRadius);
+    if ( !same ) return false;
+    input.read(reinterpret_cast<char*>(m_bits.data()), m_bits.size()*sizeof(std::uint64_t));
+    if ( !input ) return false;
+    m_buildIter = maxIter;
+    return true;
+}
+// ---------------------------------------------------------------------
+void
+InteriorMask::save( const std::string& fileName ) const
+{
+    std::ofstream output(fileName.c_str(), std::ios::binary);
+    writeValue(output, fileMagic);
+    writeValue(output, fileVersion);
+    writeValue(output, m_nx);
+    writeValue(output, m_ny);
+    writeValue(output, m_buildIter);
+    writeValue(output, reMin);
+    writeValue(output, reMax);
+    writeValue(output, imMax);
+    writeValue(output, safety);
+    writeValue(output, cycleEps);
+    writeValue(output, escapeRadius);
+    output.write(reinterpret_cast<const char*>(m_bits.data()), m_bits.size()*sizeof(std::uint64_t));
+}
+// ---------------------------------------------------------------------
+double
+InteriorMask::coveredArea() const
+{
+    std::size_t nbCells = 0;
+    for ( std::uint64_t word : m_bits ) nbCells += __builtin_popcountll(word);
+    return 2.*nbCells*m_h*m_h;
+}
+// ---------------------------------------------------------------------
+std::vector<double>
+InteriorMask::samplePoints( std::size_t nb, std::uint64_t seed ) const
+{
+    std::vector<std::size_t> cells;
+    for ( std::size_t w = 0; w < m_bits.size(); ++w )
+        for ( int b = 0; b < 64; ++b )
+            if ( (m_bits[w] >> b) & 1 ) cells.push_back(64*w + b);
+    std::vector<double> points;
+    if ( cells.empty() ) return points;
+    const Philox4x32 philox(seed);
+    for ( std::size_t k = 0; k < nb; ++k ) {
+        Philox4x32::Block block = philox.block(k);
+        std::size_t cell = cells[block[0] % cells.size()];
+        std::size_t i = cell % (64*m_wordsPerRow), j = cell/(64*m_wordsPerRow);
+        double im = (j + Philox4x32::toDouble(block[2], block[3]))*m_h;
+        points.push_back(reMin + (i + Philox4x32::toFloat(block[1]))*m_h);
+        points.push_back( block[1] & 1 ? -im : im );
+    }
+    return points;
+}
+// =====================================================================
+InteriorMask
+cachedInteriorMask( const std::string& fileName, int resolution, bool verbose )
+{
+    InteriorMask mask(resolution);
+    if ( mask.load(fileName) ) {
+        if ( verbose ) std::cout << "Masque intérieur lu dans " << fileName << std::endl;
+    } else {
+        std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+        mask.build();
+        std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+        mask.save(fileName);
+        if ( verbose ) std::cout << "Masque intérieur construit en " << elapsed.count() << " s, sauvé dans "
+                                 << fileName << std::endl;
+    }
+    if ( verbose ) std::cout << "  " << resolution << " cellules de large, aire couverte "
+                             << mask.coveredArea() << " (aire de l'ensemble : 1.5066)" << std::endl;
+    return mask;
+}
@@ -0,0 +1,78 @@
+#ifndef _INTERIOR_MASK_HPP_
+# define _INTERIOR_MASK_HPP_
+# include <cstdint>
+# include <string>
+# include <vector>
+
+/** Masque de l'intérieur de l'ensemble de Mandelbrot.
+ *
+ *  Grille de cellules carrées de côté h sur [reMin, reMax] x [0, imMax]
+ *  (l'ensemble est symétrique par rapport à l'axe réel : on teste |im|).
+ *  Une cellule n'est marquée que si elle est entièrement dans un disque
+ *  certifié intérieur : pour un c dont l'orbite a un cycle attractif de
+ *  période p, l'estimation de distance intérieure b (calculée sur le cycle
+ *  par les dérivées de f^p) vérifie, par le théorème du quart de Koebe,
+ *  dist(c, bord de M) >= b/4. On prend en plus une marge de 10% pour les
+ *  arrondis. Le masque est donc une érosion de l'intérieur : aucun point
+ *  dont l'orbite diverge n'est jamais dans une cellule marquée, les
+ *  cellules proches du bord ne sont simplement pas marquées.
+ *
+ *  Construction par quadtree en parallèle : un bloc de cellules est marqué
+ *  d'un coup si le disque certifié de son centre le couvre, écarté si son
+ *  centre est certifié extérieur de même (estimation de distance
+ *  extérieure), découpé en quatre sinon. Le masque peut être gardé sur
+ *  disque (load, save) : sa construction coûte plus qu'une image. Le
+ *  fichier commence par un mot magique, la version du format et les
+ *  paramètres de construction (grille, maxIter, marges) : un fichier
+ *  construit autrement est refusé.
+ **/
+class InteriorMask
+{
+public:
+    static constexpr double reMin = -2., reMax = 0.5, imMax = 1.25;
+    static constexpr int defaultBuildIter = 1 << 14;
+
+    /** Masque vide de resolution cellules sur l'axe réel (multiple de 64) */
+    InteriorMask( int resolution = 2048 );
+
+    /** Construit le masque ; maxIter limite la recherche du cycle de chaque
+     *  centre de bloc (au-delà, le bloc est découpé ou laissé non marqué) */
+    void build( int maxIter = defaultBuildIter );
+    /** Lit un masque sauvé par save ; faux si le fichier manque, n'a pas
+     *  le bon format ou n'a pas été construit avec cette résolution, ce
+     *  maxIter et les marges de ce programme */
+    bool load( const std::string& fileName, int maxIter = defaultBuildIter );
+    void save( const std::string& fileName ) const;
+
+    /** Vrai si (re, im) est certainement intérieur (O(1)) */
+    bool contains( double re, double im ) const
+    {
+        if ( im < 0. ) im = -im;
+        if ( (re < reMin) || (re >= reMax) || (im >= imMax) ) return false;
+        std::size_t i = std::size_t((re - reMin)*m_invH), j = std::size_t(im*m_invH);
+        if ( (i >= std::size_t(m_nx)) || (j >= std::size_t(m_ny)) ) return false;
+        return (m_bits[j*m_wordsPerRow + (i >> 6)] >> (i & 63)) & 1;
+    }
+
+    int resolution()  const { return m_nx; }
+    int buildIter()   const { return m_buildIter; }
+    double cellSize() const { return m_h; }
+    /** Aire couverte par le masque, les deux demi-plans comptés */
+    double coveredArea() const;
+    /** Tire nb points au hasard dans les cellules marquées (graine seed) */
+    std::vector<double> samplePoints( std::size_t nb, std::uint64_t seed ) const;
+private:
+    void fillBlock( int i0, int j0, int size, int maxIter );
+    void mark( int i, int j ) { m_bits[std::size_t(j)*m_wordsPerRow + (i >> 6)] |= std::uint64_t(1) << (i & 63); }
+
+    int m_nx, m_ny, m_wordsPerRow;
+    int m_buildIter;                   // maxIter de build (0 : pas construit)
+    double m_h, m_invH;
+    std::vector<std::uint64_t> m_bits; // Ligne j, mot i/64, bit i%64
+};
+
+/** Masque de la résolution demandée : lu dans fileName s'il y est, sinon
+ *  construit puis sauvé. verbose affiche le temps et l'aire couverte. */
+InteriorMask cachedInteriorMask( const std::string& fileName, int resolution = 2048, bool verbose = true );
+
+#endif
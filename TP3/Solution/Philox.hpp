@@ -0,0 +1,245 @@
+#ifndef _PHILOX_HPP_
+# define _PHILOX_HPP_
+# include <array>
+# include <cstddef>
+# include <cstdint>
+# include <limits>
+# if defined(__AVX512F__) || defined(__AVX2__)
+#   include <immintrin.h>
+# endif
+
+/** Générateur pseudo-aléatoire à compteur Philox4x32-10 (Salmon et al.,
+ *  "Parallel random numbers: as easy as 1, 2, 3", SC'11).
+ *
+ *  Pas d'état : un bloc de quatre entiers 32 bits est une fonction pure
+ *  block(counter, stream) de la clef (la graine). Chaque tirage Monte Carlo
+ *  prend ses nombres dans son propre flot (son numéro d'échantillon par
+ *  exemple) : les résultats ne dépendent ni du nombre de threads ou de
+ *  processus, ni de l'ordre des calculs, et aucun état n'est partagé entre
+ *  threads.
+ *
+ *  Les fonctions par lots calculent seize blocs à la fois, une voie SIMD
+ *  par bloc : les produits 32x32 -> 64 bits se font par vpmuludq (AVX-512
+ *  ou AVX2, selon la cible de compilation ; le compilateur seul choisit
+ *  vpmullq, bien plus lent), avec une boucle générique sinon. Tout est
+ *  dans l'en-tête pour être inliné dans les boucles de tirage (et
+ *  utilisable par TP1/Solution/pi.cpp sans autre fichier).
+ **/
+class Philox4x32
+{
+public:
+    typedef std::array<std::uint32_t, 4> Block;
+
+    explicit Philox4x32( std::uint64_t seed ) :
+        m_key0(std::uint32_t(seed)), m_key1(std::uint32_t(seed >> 32))
+    {}
+
+    /** Bloc numéro counter du flot stream */
+    Block block( std::uint64_t counter, std::uint64_t stream = 0 ) const
+    {
+        std::uint32_t c0 = std::uint32_t(counter), c1 = std::uint32_t(counter >> 32);
+        std::uint32_t c2 = std::uint32_t(stream),  c3 = std::uint32_t(stream >> 32);
+        std::uint32_t k0 = m_key0, k1 = m_key1;
+        for ( int round = 0; round < nbRounds; ++round ) {
+            std::uint64_t p0 = std::uint64_t(multiplier0)*c0;
+            std::uint64_t p1 = std::uint64_t(multiplier1)*c2;
+            c0 = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+            c1 = std::uint32_t(p1);
+            c2 = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+            c3 = std::uint32_t(p0);
+            k0 += weyl0; k1 += weyl1;
+        }
+        return Block{ { c0, c1, c2, c3 } };
+    }
+
+    /** Réel uniforme de [0,1) tiré de 32 bits (24 significatifs) */
+    static float toFloat( std::uint32_t w )
+    {
+        return float(w >> 8)*(1.f/16777216.f);
+    }
+    /** Réel uniforme de [0,1) tiré de 64 bits (53 significatifs) */
+    static double toDouble( std::uint32_t lo, std::uint32_t hi )
+    {
+        return double(((std::uint64_t(hi) << 32) | lo) >> 11)*(1./9007199254740992.);
+    }
+
+    /** Blocs firstCounter à firstCounter + nbBlocks - 1 du flot stream,
+     *  rangés à la suite dans out (4*nbBlocks entiers) */
+    void blocks( std::uint64_t firstCounter, std::uint64_t stream, std::size_t nbBlocks,
+                 std::uint32_t* out ) const
+    {
+        for ( std::size_t base = 0; base < nbBlocks; base += lanes ) {
+            std::uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+            batch(firstCounter + base, stream, c0, c1, c2, c3);
+            const std::size_t nb = ( nbBlocks - base < lanes ? nbBlocks - base : lanes );
+            for ( std::size_t l = 0; l < nb; ++l ) {
+                out[4*(base+l)  ] = c0[l];
+                out[4*(base+l)+1] = c1[l];
+                out[4*(base+l)+2] = c2[l];
+                out[4*(base+l)+3] = c3[l];
+            }
+        }
+    }
+
+    /** 4*nbBlocks réels uniformes de [0,1) en simple précision, tirés des
+     *  blocs firstCounter, ... du flot stream (quatre par bloc, dans l'ordre
+     *  des mots) */
+    void uniformFloats( std::uint64_t firstCounter, std::uint64_t stream, std::size_t nbBlocks,
+                        float* out ) const
+    {
+        for ( std::size_t base = 0; base < nbBlocks; base += lanes ) {
+            std::uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+            batch(firstCounter + base, stream, c0, c1, c2, c3);
+            const std::size_t nb = ( nbBlocks - base < lanes ? nbBlocks - base : lanes );
+            for ( std::size_t l = 0; l < nb; ++l ) {
+                out[4*(base+l)  ] = toFloat(c0[l]);
+                out[4*(base+l)+1] = toFloat(c1[l]);
+                out[4*(base+l)+2] = toFloat(c2[l]);
+                out[4*(base+l)+3] = toFloat(c3[l]);
+            }
+        }
+    }
+
+    /** 2*nbBlocks réels uniformes de [0,1) en double précision (deux par
+     *  bloc : mots 0 et 1, puis mots 2 et 3) */
+    void uniformDoubles( std::uint64_t firstCounter, std::uint64_t stream, std::size_t nbBlocks,
+                         double* out ) const
+    {
+        for ( std::size_t base = 0; base < nbBlocks; base += lanes ) {
+            std::uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+            batch(firstCounter + base, stream, c0, c1, c2, c3);
+            const std::size_t nb = ( nbBlocks - base < lanes ? nbBlocks - base : lanes );
+            for ( std::size_t l = 0; l < nb; ++l ) {
+                out[2*(base+l)  ] = toDouble(c0[l], c1[l]);
+                out[2*(base+l)+1] = toDouble(c2[l], c3[l]);
+            }
+        }
+    }
+
+    /** Parcours séquentiel d'un flot, utilisable comme un générateur de la
+     *  bibliothèque standard (std::uniform_real_distribution, ...) */
+    class Stream
+    {
+    public:
+        typedef std::uint32_t result_type;
+
+        Stream( const Philox4x32& philox, std::uint64_t stream ) :
+            m_philox(philox), m_stream(stream), m_counter(0), m_word(4), m_block()
+        {}
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()()
+        {
+            if ( m_word == 4 ) {
+                m_block = m_philox.block(m_counter++, m_stream);
+                m_word = 0;
+            }
+            return m_block[m_word++];
+        }
+    private:
+        const Philox4x32& m_philox;
+        std::uint64_t m_stream, m_counter;
+        int m_word;
+        Block m_block;
+    };
+
+private:
+    enum { nbRounds = 10, lanes = 16 };
+    static const std::uint32_t multiplier0 = 0xD2511F53U, multiplier1 = 0xCD9E8D57U;
+    static const std::uint32_t weyl0 = 0x9E3779B9U, weyl1 = 0xBB67AE85U;
+
+    // Seize blocs consécutifs, un par voie
+    void batch( std::uint64_t firstCounter, std::uint64_t stream,
+                std::uint32_t* c0, std::uint32_t* c1, std::uint32_t* c2, std::uint32_t* c3 ) const
+    {
+        for ( int l = 0; l < lanes; ++l ) {
+            c0[l] = std::uint32_t(firstCounter + l);
+            c1[l] = std::uint32_t((firstCounter + l) >> 32);
+            c2[l] = std::uint32_t(stream);
+            c3[l] = std::uint32_t(stream >> 32);
+        }
+        std::uint32_t k0 = m_key0, k1 = m_key1;
+# if defined(__AVX512F__)
+        __m512i x0 = _mm512_loadu_si512(c0), x1 = _mm512_loadu_si512(c1);
+        __m512i x2 = _mm512_loadu_si512(c2), x3 = _mm512_loadu_si512(c3);
+        const __m512i m0 = _mm512_set1_epi32(int(multiplier0)), m1 = _mm512_set1_epi32(int(multiplier1));
+        for ( int round = 0; round < nbRounds; ++round ) {
+            __m512i hi0, lo0, hi1, lo1;
+            mulHiLo(x0, m0, hi0, lo0);
+            mulHiLo(x2, m1, hi1, lo1);
+            x0 = _mm512_xor_si512(_mm512_xor_si512(hi1, x1), _mm512_set1_epi32(int(k0)));
+            x1 = lo1;
+            x2 = _mm512_xor_si512(_mm512_xor_si512(hi0, x3), _mm512_set1_epi32(int(k1)));
+            x3 = lo0;
+            k0 += weyl0; k1 += weyl1;
+        }
+        _mm512_storeu_si512(c0, x0); _mm512_storeu_si512(c1, x1);
+        _mm512_storeu_si512(c2, x2); _mm512_storeu_si512(c3, x3);
+# elif defined(__AVX2__)
+        const __m256i m0 = _mm256_set1_epi32(int(multiplier0)), m1 = _mm256_set1_epi32(int(multiplier1));
+        for ( int half = 0; half < lanes; half += 8 ) {
+            __m256i x0 = _mm256_loadu_si256((const __m256i*)(c0 + half));
+            __m256i x1 = _mm256_loadu_si256((const __m256i*)(c1 + half));
+            __m256i x2 = _mm256_loadu_si256((const __m256i*)(c2 + half));
+            __m256i x3 = _mm256_loadu_si256((const __m256i*)(c3 + half));
+            std::uint32_t r0 = k0, r1 = k1;
+            for ( int round = 0; round < nbRounds; ++round ) {
+                __m256i hi0, lo0, hi1, lo1;
+                mulHiLo(x0, m0, hi0, lo0);
+                mulHiLo(x2, m1, hi1, lo1);
+                x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32(int(r0)));
+                x1 = lo1;
+                x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32(int(r1)));
+                x3 = lo0;
+                r0 += weyl0; r1 += weyl1;
+            }
+            _mm256_storeu_si256((__m256i*)(c0 + half), x0);
+            _mm256_storeu_si256((__m256i*)(c1 + half), x1);
+            _mm256_storeu_si256((__m256i*)(c2 + half), x2);
+            _mm256_storeu_si256((__m256i*)(c3 + half), x3);
+        }
+# else
+        for ( int round = 0; round < nbRounds; ++round ) {
+            for ( int l = 0; l < lanes; ++l ) {
+                std::uint64_t p0 = std::uint64_t(multiplier0)*c0[l];
+                std::uint64_t p1 = std::uint64_t(multiplier1)*c2[l];
+                c0[l] = std::uint32_t(p1 >> 32) ^ c1[l] ^ k0;
+                c1[l] = std::uint32_t(p1);
+                c2[l] = std::uint32_t(p0 >> 32) ^ c3[l] ^ k1;
+                c3[l] = std::uint32_t(p0);
+            }
+            k0 += weyl0; k1 += weyl1;
+        }
+# endif
+    }
+
+# if defined(__AVX512F__)
+    typedef std::uint64_t U64x8 __attribute__((vector_size(64)));
+
+    // Parties haute et basse des produits 32x32 -> 64 bits, voie par voie :
+    // vpmuludq sur les voies paires, puis sur les impaires décalées. Formes
+    // masquées et décalages par extension vectorielle : les formes non
+    // masquées déclenchent un faux -Wmaybe-uninitialized avec GCC 12.
+    static void mulHiLo( __m512i a, __m512i m, __m512i& hi, __m512i& lo )
+    {
+        __m512i even = _mm512_maskz_mul_epu32(0xFF, a, m);
+        __m512i odd  = _mm512_maskz_mul_epu32(0xFF, __m512i(U64x8(a) >> 32), m);
+        lo = _mm512_mask_blend_epi32(0xAAAA, even, __m512i(U64x8(odd) << 32));
+        hi = _mm512_mask_blend_epi32(0xAAAA, __m512i(U64x8(even) >> 32), odd);
+    }
+# elif defined(__AVX2__)
+    static void mulHiLo( __m256i a, __m256i m, __m256i& hi, __m256i& lo )
+    {
+        __m256i even = _mm256_mul_epu32(a, m);
+        __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+        lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+    }
+# endif
+
+    std::uint32_t m_key0, m_key1;
+};
+
+#endif
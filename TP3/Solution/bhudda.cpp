@@ -9,125 +9,769 @@
 # include <algorithm>
 # include <chrono>
 # include <fstream>
+# include <cstdlib>
+# include <memory>
+# include <cstring>
+# include <string>
+# include <omp.h>
+# if defined(__SSE__)
+#   include <immintrin.h>
+# endif
+# include "BuddhaHistogram.hpp"
+# include "BuddhaKernel.hpp"
+# include "InteriorMask.hpp"
+# include "Philox.hpp"
 
-struct Complex
+/* Test d'échappement vectoriel (phase 1 de bhuddabrotChannels).
+ *
+ * Chaque voie SIMD suit son propre c ; dès qu'une voie a fini (échappement,
+ * cycle ou maxIter), on la recharge avec le c suivant de la liste, sans
+ * attendre les autres voies. Types vectoriels de GCC (vector_size), de la
+ * largeur des registres de la cible (16 floats en AVX-512). Les orbites
+ * retenues sont ensuite refaites une par une par comp_mandelbrot_orbit :
+ * elles sont courtes pour la plupart et l'ajout dans l'histogramme reste
+ * scalaire, une version vectorielle n'y gagnait rien.
+ */
+# if defined(__AVX512F__)
+#   define BHUDDA_SIMD_BYTES 64
+# elif defined(__AVX__)
+#   define BHUDDA_SIMD_BYTES 32
+# else
+#   define BHUDDA_SIMD_BYTES 16
+# endif
+typedef float FloatLanes __attribute__((vector_size(BHUDDA_SIMD_BYTES)));
+typedef std::int32_t IntLanes __attribute__((vector_size(BHUDDA_SIMD_BYTES)));
+const int nbLanes = BHUDDA_SIMD_BYTES/4;
+
+// Bit l à 1 si la voie l de mask est vraie
+inline unsigned lane_bits( IntLanes mask )
+{
+# if defined(__AVX512F__)
+    return _mm512_movepi32_mask(__m512i(mask));
+# elif defined(__AVX__)
+    return _mm256_movemask_ps(__m256(mask));
+# elif defined(__SSE__)
+    return _mm_movemask_ps(__m128(mask));
+# else
+    unsigned bits = 0;
+    for ( int l = 0; l < nbLanes; ++l ) bits |= ( mask[l] ? 1U << l : 0U );
+    return bits;
+# endif
+}
+
+# pragma GCC push_options
+# pragma GCC optimize("fp-contract=off")
+// Version vectorielle de in_known_convergence_zone, sans le masque
+// intérieur : mêmes formules en float, mêmes réponses sur les bords
+IntLanes in_known_convergence_zones( FloatLanes re, FloatLanes im )
+{
+    FloatLanes im2 = im*im, ai = ( im < 0.f ? -im : im );
+    IntLanes known = (re*re + im2 < 0.0625f) | ((re+1.f)*(re+1.f) + im2 < 0.0625f);
+    // |ct| < (1 - ct.re/|ct|)/2  <=>  2|ct|² + ct.re < |ct|
+    FloatLanes x = re - 0.25f, q2 = x*x + im2, a = 2.f*q2 + x;
+    known |= (re > -0.75f) & (re < 0.5f) & ((a < 0.f) | (a*a < q2));
+    known |= (re+0.125f)*(re+0.125f) + (ai-0.744862f)*(ai-0.744862f) < 0.0915f*0.0915f;
+    known |= (re-0.28113f)*(re-0.28113f) + (ai-0.53120f)*(ai-0.53120f) < 0.0425f*0.0425f;
+    known |= (re+1.30919f)*(re+1.30919f) + im2 < 0.0575f*0.0575f;
+    known |= (re+1.75931f)*(re+1.75931f) + im2 < 0.0090f*0.0090f;
+    return known;
+}
+
+// escapes[k] = escape_iteration(maxIter, (cre[k], cim[k])) pour les k de
+// todo[0..n), sans les tests de zones connues (déjà faits). Une fois la
+// file vide, les orbites encore en cours sont finies en scalaire : les
+// dernières voies occupées ne laissent pas les autres tourner à vide.
+void escape_iterations_simd( int maxIter, const float* cre, const float* cim, const long* todo, long n,
+                             unsigned long* escapes )
+{
+    FloatLanes zr = {}, zi = {}, cr = {}, ci = {}, sr = {}, si = {};
+    IntLanes it = {}, ck = {}, live = {};
+    long slot[nbLanes];
+    long next = 0;
+    int nbActive = 0;
+    // (Re)charge la voie l avec le prochain c, ou la neutralise
+    auto refill = [&] ( int l ) {
+        zr[l] = 0.f; zi[l] = 0.f; sr[l] = 0.f; si[l] = 0.f;
+        it[l] = 0; ck[l] = 1;
+        live[l] = ( next < n ? -1 : 0 );
+        if ( live[l] ) slot[l] = todo[next++];
+        cr[l] = ( live[l] ? cre[slot[l]] : 0.f );
+        ci[l] = ( live[l] ? cim[slot[l]] : 0.f );
+        return live[l] != 0;
+    };
+    for ( int l = 0; l < nbLanes; ++l ) nbActive += refill(l);
+    while ( (nbActive > 0) && (next < n) ) {
+        // Quelques itérations entre deux recharges ; une voie finie garde
+        // son compte, son z (qui diverge) n'est plus lu
+        IntLanes done = {};
+        for ( int step = 0; step < 8; ++step ) {
+            FloatLanes zr2 = zr*zr, zi2 = zi*zi;
+            done |= live & ((zr2 + zi2 >= 4.f) | (it >= maxIter));
+            IntLanes running = live & ~done;
+            zi = 2.f*zr*zi + ci;
+            zr = zr2 - zi2 + cr;
+            it -= running;
+            // Détection de cycle (Brent), comme dans escape_iteration
+            IntLanes cycle = running & (zr == sr) & (zi == si);
+            it = cycle ? maxIter : it;
+            IntLanes save = running & ~cycle & (it == ck);
+            sr = save ? zr : sr;
+            si = save ? zi : si;
+            ck = save ? ck + ck : ck;
+        }
+        for ( int l = 0; l < nbLanes; ++l ) {
+            if ( !done[l] ) continue;
+            escapes[slot[l]] = it[l];
+            if ( !refill(l) ) --nbActive;
+        }
+    }
+    for ( int l = 0; l < nbLanes; ++l ) {
+        if ( !live[l] ) continue;
+        escapes[slot[l]] = continue_escape( maxIter, Complex(cr[l], ci[l]), Complex(zr[l], zi[l]),
+                                            Complex(sr[l], si[l]), ck[l], it[l] );
+    }
+}
+# pragma GCC pop_options
+
+// Temps de calcul et d'attente (fin de boucle) de chaque thread, puis
+// déséquilibre : temps de calcul maximal sur temps moyen
+void reportImbalance( const std::vector<double>& busy, double wallTime )
 {
-    float re, im;    
-    Complex() : re(0.), im(0.)
-    {}
-    Complex(double r, double i) : re(r), im(i)
-    {}
-    double sqNorm() { return re*re + im*im; }
-    Complex operator + ( const Complex& z )
+    double total = 0., maxBusy = 0.;
+    for ( std::size_t t = 0; t < busy.size(); ++t ) {
+        std::cout << "  Thread " << t << " : calcul " << busy[t] << " s, attente "
+                  << wallTime - busy[t] << " s" << std::endl;
+        total  += busy[t];
+        maxBusy = std::max(maxBusy, busy[t]);
+    }
+    std::cout << "  Déséquilibre (calcul max/moyen) : " << maxBusy/(total/busy.size()) << std::endl;
+}
+// Tirage des échantillons : boucle partagée entre les threads de la région
+// parallèle englobante, chacun accumulant dans acc. Avec useSymmetry, un
+// tirage compte pour deux échantillons (nbSamples arrondi au pair
+// supérieur). Renvoie le nombre de c dont le thread a testé l'orbite
+// (rejetés compris).
+template<typename Accumulator>
+unsigned long sample_orbits( unsigned long nbSamples, unsigned long maxIter, unsigned width, unsigned height,
+                    const Philox4x32& philox, Accumulator& acc )
+{
+    // Répartition des échantillons choisie à l'exécution par OMP_SCHEDULE
+    // (par exemple "static", "dynamic,1000" ou "guided")
+    unsigned long nbEvaluations = 0;
+    const unsigned long nbDraws = ( useSymmetry ? (nbSamples + 1)/2 : nbSamples );
+ #  pragma omp for schedule(runtime) nowait
+    for ( unsigned long iSample = 0; iSample < nbDraws; iSample++)
+        nbEvaluations += sample_orbit( iSample, maxIter, width, height, philox, acc );
+    return nbEvaluations;
+}
+// Bhuddabrot to test the chronometer
+// ---------------------------------------------------------------------
+// Les tirages ne dépendent que de seed : même image (aux arrondis de la
+// somme près, aucun pour des compteurs entiers) quel que soit le nombre de
+// threads ou la répartition des échantillons.
+Histogram
+bhuddabrot ( unsigned long nbSamples, unsigned long maxIter, unsigned width, unsigned height,
+             histogram_mode mode, std::uint64_t seed, bool report = true,
+             unsigned long* nbEvaluations = nullptr )
+{
+    if ( report ) std::cerr << "Entring in Bhudda brot\n";
+    const Philox4x32 philox(seed);
+
+    if ( report ) std::cerr << "Computing starting c\n";
+    const std::size_t size = std::size_t(width)*height;
+    Histogram image;
+    std::vector<Histogram> privates;
+    std::unique_ptr<TiledHistogram> tiled;
+    if ( mode == atomic_histogram ) image.assign(size, 0);
+    else if ( mode == tiled_histogram ) tiled.reset(new TiledHistogram(size));
+    else privates.resize(omp_get_max_threads());
+    // dynamic,1000 par défaut. On mesure le temps de calcul de chaque
+    // thread pour comparer les répartitions.
+    if ( std::getenv("OMP_SCHEDULE") == nullptr ) omp_set_schedule(omp_sched_dynamic, 1000);
+    std::vector<double> busy(omp_get_max_threads(), 0.);
+    unsigned long nbEvals = 0;
+    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+ #  pragma omp parallel reduction(+:nbEvals)
     {
-        return Complex(re + z.re, im + z.im );
+    std::chrono::time_point<std::chrono::system_clock> startThread = std::chrono::system_clock::now();
+    if ( mode == private_histogram ) {
+        // Alloué et mis à zéro par son thread (mémoire locale du thread)
+        Histogram& own = privates[omp_get_thread_num()];
+        own.assign(size, 0);
+        PrivateAccumulator acc(own);
+        nbEvals += sample_orbits( nbSamples, maxIter, width, height, philox, acc );
+    } else if ( mode == tiled_histogram ) {
+        TiledAccumulator acc(*tiled);
+        nbEvals += sample_orbits( nbSamples, maxIter, width, height, philox, acc );
+        acc.flush();
+    } else {
+        AtomicAccumulator acc(image);
+        nbEvals += sample_orbits( nbSamples, maxIter, width, height, philox, acc );
+    }
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - startThread;
+    busy[omp_get_thread_num()] = elapsed.count();
     }
-    Complex operator * ( const Complex& z )
+    std::chrono::duration<double> wall = std::chrono::system_clock::now() - start;
+    if ( report ) reportImbalance(busy, wall.count());
+    if ( nbEvaluations ) *nbEvaluations = nbEvals;
+    if ( mode == private_histogram ) {
+        // Moins de threads que prévu possible : on ne garde que les histogrammes remplis
+        privates.erase(std::remove_if(privates.begin(), privates.end(),
+                                      [] ( const Histogram& h ) { return h.empty(); }),
+                       privates.end());
+        start = std::chrono::system_clock::now();
+        treeReduce(privates);
+        wall = std::chrono::system_clock::now() - start;
+        if ( report ) std::cout << "  Réduction des histogrammes : " << wall.count() << " s" << std::endl;
+        image = std::move(privates[0]);
+    } else if ( mode == tiled_histogram )
+        image = std::move(tiled->counts());
+    return image;
+}
+
+/* Image en couleur en une seule passe.
+ *
+ * Chaque couche (canal) de l'image est un Bhuddabrot à part entière :
+ * nbSamples orbites divergeant en moins de maxIter itérations. Une orbite
+ * qui s'échappe à l'itération n est valable pour toutes les couches de
+ * seuil maxIter > n : on tire donc les c une seule fois, on teste chacun
+ * avec le plus grand seuil des couches encore incomplètes, et on dépose
+ * son orbite, calculée une seule fois, dans toutes les couches qui
+ * l'acceptent et dont le quota n'est pas atteint. Chaque couche reçoit
+ * ainsi exactement ses nbSamples orbites, tirées selon la même loi qu'avec
+ * bhuddabrot, pour à peu près le coût de la couche la plus chère.
+ */
+struct Channel
+{
+    unsigned long nbSamples, maxIter;
+};
+
+// Accumulateur qui ajoute chaque point dans plusieurs couches
+template<typename Accumulator>
+struct ChannelsAccumulator
+{
+    std::vector<Accumulator*> active;
+    void add( std::size_t ind ) { for ( Accumulator* acc : active ) acc->add(ind); }
+};
+
+// État partagé par les threads : les échantillons sont traités par
+// tranches ; pour chacune, le seuil du test, l'itération d'échappement de
+// chaque échantillon et les couches (bits de mask) qui le prennent
+struct ChannelsPass
+{
+    static const long chunkSize = 1L << 13;
+    static const long batchSize = 1024;   // Échantillons tirés d'un coup
+    std::vector<unsigned long> quotas;
+    unsigned long maxIter;
+    std::vector<float> cre, cim;          // Points c de la tranche
+    std::vector<unsigned long> escapes;
+    std::vector<std::uint32_t> masks;
+
+    ChannelsPass( const std::vector<Channel>& channels ) :
+        quotas(channels.size()), maxIter(0), cre(chunkSize), cim(chunkSize), escapes(chunkSize),
+        masks(chunkSize)
     {
-        return Complex(re*z.re-im*z.im, re*z.im+im*z.re);
+        for ( std::size_t k = 0; k < channels.size(); ++k ) quotas[k] = channels[k].nbSamples;
+    }
+};
+
+// Boucle des threads de la région parallèle englobante, accs[k] ajoutant
+// dans la couche k. Par tranche :
+//   1. points c (Philox par lots, flot 0, compteur = numéro d'échantillon)
+//      et itération d'échappement, en parallèle ;
+//   2. attribution aux couches dans l'ordre des échantillons, par un seul
+//      thread (peu coûteux) : le résultat ne dépend pas du nombre de
+//      threads ;
+//   3. orbites des c retenus, en parallèle.
+// Avec simd, la phase 1 teste les zones connues par voies, puis chaque
+// thread passe les c restants de sa part de la tranche en une fois à
+// escape_iterations_simd.
+// Renvoie le nombre de c testés par le thread (rejetés compris).
+template<typename Accumulator>
+unsigned long sample_channels( const std::vector<Channel>& channels, ChannelsPass& pass,
+                               const Philox4x32& philox, unsigned width, unsigned height,
+                               const std::vector<Accumulator*>& accs, bool simd )
+{
+    static_assert(ChannelsPass::batchSize % nbLanes == 0, "lots de voies SIMD entières");
+    ChannelsAccumulator<Accumulator> acc;
+    std::vector<float> uniforms(4*ChannelsPass::batchSize);
+    std::vector<long> todo(ChannelsPass::chunkSize);
+    unsigned long nbEvaluations = 0;
+    for ( std::uint64_t first = 0; ; first += ChannelsPass::chunkSize ) {
+ #      pragma omp single
+        {
+            // Plus grand seuil des couches encore incomplètes
+            pass.maxIter = 0;
+            for ( std::size_t k = 0; k < channels.size(); ++k )
+                if ( pass.quotas[k] > 0 ) pass.maxIter = std::max(pass.maxIter, channels[k].maxIter);
+        }
+        if ( pass.maxIter == 0 ) break;
+        long nbTodo = 0;
+ #      pragma omp for schedule(static) nowait
+        for ( long batch = 0; batch < ChannelsPass::chunkSize; batch += ChannelsPass::batchSize ) {
+            const float* u = uniforms.data();
+            philox.uniformFloats( first + batch, 0, ChannelsPass::batchSize, uniforms.data() );
+            for ( long i = batch; i < batch + ChannelsPass::batchSize; ++i, u += 4 ) {
+                Complex c = draw_point(u[0], u[1]);
+                pass.cre[i] = c.re;
+                pass.cim[i] = c.im;
+                if ( !simd ) pass.escapes[i] = escape_iteration( pass.maxIter, c );
+            }
+            nbEvaluations += ChannelsPass::batchSize;
+            if ( !simd ) continue;
+            for ( long i = batch; i < batch + ChannelsPass::batchSize; i += nbLanes ) {
+                FloatLanes re, im;
+                std::memcpy(&re, &pass.cre[i], sizeof(re));
+                std::memcpy(&im, &pass.cim[i], sizeof(im));
+                unsigned known = lane_bits(in_known_convergence_zones(re, im));
+                for ( int l = 0; l < nbLanes; ++l ) {
+                    if ( ((known >> l) & 1) || (interiorMask && interiorMask->contains(re[l], im[l])) )
+                        pass.escapes[i + l] = pass.maxIter;
+                    else
+                        todo[nbTodo++] = i + l;
+                }
+            }
+        }
+        if ( simd )
+            escape_iterations_simd( pass.maxIter, pass.cre.data(), pass.cim.data(), todo.data(), nbTodo,
+                                    pass.escapes.data() );
+ #      pragma omp barrier
+ #      pragma omp single
+        for ( long i = 0; i < ChannelsPass::chunkSize; ++i ) {
+            std::uint32_t mask = 0;
+            for ( std::size_t k = 0; k < channels.size(); ++k )
+                if ( (pass.quotas[k] > 0) && (pass.escapes[i] < channels[k].maxIter) ) {
+                    mask |= (1U << k);
+                    pass.quotas[k] -= std::min(pass.quotas[k], useSymmetry ? 2UL : 1UL);
+                }
+            pass.masks[i] = mask;
+        }
+ #      pragma omp for schedule(dynamic, 64)
+        for ( long i = 0; i < ChannelsPass::chunkSize; ++i ) {
+            if ( pass.masks[i] == 0 ) continue;
+            acc.active.clear();
+            for ( std::size_t k = 0; k < channels.size(); ++k )
+                if ( pass.masks[i] & (1U << k) ) acc.active.push_back(accs[k]);
+            comp_mandelbrot_orbit( pass.maxIter, Complex(pass.cre[i], pass.cim[i]), width, height, acc,
+                                   useSymmetry );
+        }
     }
+    return nbEvaluations;
+}
 
+// Toutes les couches en une passe (32 au plus), avec l'accumulation mode.
+// Comme pour bhuddabrot, l'image ne dépend que de seed. simd choisit le
+// test d'échappement vectoriel ou scalaire (même image).
+std::vector<Histogram>
+bhuddabrotChannels( const std::vector<Channel>& channels, unsigned width, unsigned height,
+                    histogram_mode mode, std::uint64_t seed, unsigned long* nbEvaluations = nullptr,
+                    bool simd = true )
+{
+    assert(channels.size() <= 32);
+    const std::size_t size = std::size_t(width)*height;
+    const std::size_t nbChannels = channels.size();
+    const int nbThreads = omp_get_max_threads();
+    std::vector<Histogram> images(nbChannels);
+    std::vector<std::vector<Histogram>> privates(nbChannels);
+    std::vector<std::unique_ptr<TiledHistogram>> tiled(nbChannels);
+    for ( std::size_t k = 0; k < nbChannels; ++k ) {
+        if ( mode == atomic_histogram ) images[k].assign(size, 0);
+        else if ( mode == tiled_histogram ) tiled[k].reset(new TiledHistogram(size));
+        else privates[k].resize(nbThreads);
+    }
+    const Philox4x32 philox(seed);
+    ChannelsPass pass(channels);
+    unsigned long nbEvals = 0;
+ #  pragma omp parallel reduction(+:nbEvals)
+    {
+        const int thread = omp_get_thread_num();
+        if ( mode == private_histogram ) {
+            std::vector<PrivateAccumulator> accs;
+            for ( std::size_t k = 0; k < nbChannels; ++k ) {
+                Histogram& own = privates[k][thread];
+                own.assign(size, 0);
+                accs.emplace_back(own);
+            }
+            std::vector<PrivateAccumulator*> pointers;
+            for ( PrivateAccumulator& acc : accs ) pointers.push_back(&acc);
+            nbEvals += sample_channels( channels, pass, philox, width, height, pointers, simd );
+        } else if ( mode == tiled_histogram ) {
+            std::vector<std::unique_ptr<TiledAccumulator>> accs;
+            std::vector<TiledAccumulator*> pointers;
+            for ( std::size_t k = 0; k < nbChannels; ++k ) {
+                accs.emplace_back(new TiledAccumulator(*tiled[k]));
+                pointers.push_back(accs.back().get());
+            }
+            nbEvals += sample_channels( channels, pass, philox, width, height, pointers, simd );
+            for ( TiledAccumulator* acc : pointers ) acc->flush();
+        } else {
+            std::vector<AtomicAccumulator> accs;
+            for ( std::size_t k = 0; k < nbChannels; ++k ) accs.emplace_back(images[k]);
+            std::vector<AtomicAccumulator*> pointers;
+            for ( AtomicAccumulator& acc : accs ) pointers.push_back(&acc);
+            nbEvals += sample_channels( channels, pass, philox, width, height, pointers, simd );
+        }
+    }
+    if ( nbEvaluations ) *nbEvaluations = nbEvals;
+    for ( std::size_t k = 0; k < nbChannels; ++k ) {
+        if ( mode == private_histogram ) {
+            privates[k].erase(std::remove_if(privates[k].begin(), privates[k].end(),
+                                             [] ( const Histogram& h ) { return h.empty(); }),
+                              privates[k].end());
+            treeReduce(privates[k]);
+            images[k] = std::move(privates[k][0]);
+        } else if ( mode == tiled_histogram )
+            images[k] = std::move(tiled[k]->counts());
+    }
+    return images;
+}
 
+// Accumulateur qui garde les indices des points de l'orbite dans l'image
+// au lieu de les ajouter à un histogramme
+struct HitRecorder
+{
+    std::vector<std::uint32_t>& hits;
+    void add( std::size_t ind ) { hits.push_back(std::uint32_t(ind)); }
 };
 
-bool test_mandelbrot_divergent( int maxIter, const Complex& c)
-{
-    Complex z{0.,0.};
-    // On vérifie dans un premier temps si le complexe
-    // n'appartient pas à une zone de convergence connue :
-    // Appartenance aux disques  C0{(0,0),1/4} et C1{(-1,0),1/4}
-    if ( c.re*c.re+c.im*c.im < 0.0625 )
-        return false;
-    if ( (c.re+1)*(c.re+1)+c.im*c.im < 0.0625 )
-        return false;
-    // Appartenance à la cardioïde {(1/4,0),1/2(1-cos(theta))}    
-    if ((c.re > -0.75) && (c.re < 0.5) ) {
-        Complex ct{c.re-0.25f,c.im};
-        double ctnrm2 = sqrt(ct.sqNorm());
-        if (ctnrm2 < 0.5f*(1.f-ct.re/ctnrm2)) return false;
-    }
-    int niter = 0;
-    while ((z.sqNorm() < 4.) && (niter < maxIter))
+/* Échantillonnage de Metropolis-Hastings.
+ *
+ * Le tirage direct de c (rayon uniforme dans [0,2], angle uniforme, de
+ * densité u(c) = 1/(4 pi |c|)) passe l'essentiel de son temps sur des c
+ * qui ne divergent pas ou dont l'orbite ne laisse que quelques points.
+ * Ici, chaque thread fait évoluer sa propre chaîne de Markov de c, de loi
+ * stationnaire pi(c) proportionnelle à I(c) u(c), où I(c) est le nombre de
+ * points de l'orbite de c dans l'image (0 si c ne diverge pas) : les c
+ * "productifs" sont visités plus souvent. Pour garder la même image
+ * qu'avec le tirage direct, chaque état dépose son orbite avec le poids
+ * 1/I(c) (autant de fois que la chaîne y reste).
+ *
+ * Proposition depuis c : avec la probabilité jumpProbability, un tirage
+ * direct (saut, qui garantit que toute la zone est explorée) ; sinon une
+ * petite perturbation de rayon log-uniforme dans [smallStep, largeStep].
+ * Le mélange n'étant pas symétrique, on accepte c' avec la probabilité
+ * min(1, pi(c') q(c|c') / (pi(c) q(c'|c))), q étant la densité du mélange.
+ */
+namespace {
+    const double jumpProbability = 0.2;
+    const double smallStep = 1.E-4, largeStep = 0.1;
+    const double pi = 3.141592653589793;
+
+    double directDensity( const Complex& c )
+    {
+        double r = std::sqrt(double(c.re)*c.re + double(c.im)*c.im);
+        return ( r > 0. && r < 2. ? 1./(4.*pi*r) : 0. );
+    }
+
+    // Densité de proposer to depuis from
+    double proposalDensity( const Complex& from, const Complex& to )
+    {
+        double dr = double(to.re) - from.re, di = double(to.im) - from.im;
+        double r2 = dr*dr + di*di;
+        double step = ( (r2 >= smallStep*smallStep) && (r2 <= largeStep*largeStep)
+                        ? 1./(2.*pi*r2*std::log(largeStep/smallStep)) : 0. );
+        return jumpProbability*directDensity(to) + (1.-jumpProbability)*step;
+    }
+}
+
+// Image pondérée par Metropolis-Hastings : une chaîne par thread, pendant
+// timeBudget secondes. nbEvaluations reçoit le nombre d'orbites testées,
+// acceptance le taux d'acceptation des propositions. La chaîne du thread t
+// tire ses nombres dans le flot Philox t de la graine seed (le résultat,
+// limité en temps, n'est pas reproductible pour autant).
+std::vector<double>
+bhuddabrotMetropolis ( double timeBudget, unsigned long maxIter, unsigned width, unsigned height,
+                       std::uint64_t seed, unsigned long* nbEvaluations = nullptr,
+                       double* acceptance = nullptr )
+{
+    const std::size_t size = std::size_t(width)*height;
+    std::vector<std::vector<double>> privates(omp_get_max_threads());
+    const Philox4x32 philox(seed);
+    unsigned long nbEvals = 0, nbAccepted = 0, nbSteps = 0;
+    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+    auto elapsed = [&start] () {
+        std::chrono::duration<double> d = std::chrono::system_clock::now() - start;
+        return d.count();
+    };
+ #  pragma omp parallel reduction(+:nbEvals,nbAccepted,nbSteps)
     {
-        z = z*z + c;
-        ++niter;
-    }
-    return (niter < maxIter);
-}
-
-void comp_mandelbrot_orbit( int maxIter, const Complex& c, unsigned width, unsigned height, 
-                            std::vector<unsigned>& image )
-{
-     int i = 0;
-     Complex z{0.,0.};
-     Complex z2{0.,0.};
-     while ( (z2.re+z2.im < float(4)) && (i<maxIter) )
-     {
-        z.im = float(2)*z.re*z.im + c.im;
-        z.re = z2.re - z2.im + c.re;
-        z2.re = z.re*z.re;
-        z2.im = z.im*z.im;
-        unsigned ip = unsigned((float(2)+z.im)*width/float(4));
-        unsigned jp = unsigned((float(2)+z.re)*height/float(4));
-        if ( (ip<width) && (jp<height) ) {
-           int ind = ip+jp*width;
-#          pragma omp atomic
-           image[ind] += 1;
+        std::vector<double>& image = privates[omp_get_thread_num()];
+        image.assign(size, 0.);
+        Philox4x32::Stream generator(philox, omp_get_thread_num());
+        std::uniform_real_distribution<float> uniformFloat(0.,1.);
+        std::uniform_real_distribution<double> unit(0.,1.);
+        auto direct = [&] () {
+            float u = uniformFloat(generator);
+            return disk_point( u, uniformFloat(generator) );
+        };
+        // Points de l'orbite de c dans l'image (aucun si c ne diverge pas)
+        auto evaluate = [&] ( const Complex& c, std::vector<std::uint32_t>& hits ) {
+            hits.clear();
+            nbEvals += 1;
+            if ( test_mandelbrot_divergent( maxIter, c ) ) {
+                HitRecorder recorder{hits};
+                comp_mandelbrot_orbit( maxIter, c, width, height, recorder );
+            }
+        };
+        std::vector<std::uint32_t> hits, proposalHits;
+        Complex c;
+        // État initial : premier tirage direct productif
+        do {
+            c = direct();
+            evaluate(c, hits);
+        } while ( hits.empty() && elapsed() < timeBudget );
+        double stay = 0.; // Nombre d'étapes passées sur l'état courant
+        auto deposit = [&] () {
+            double weight = stay/hits.size();
+            for ( std::uint32_t ind : hits ) image[ind] += weight;
+        };
+        while ( !hits.empty() && elapsed() < timeBudget ) {
+            nbSteps += 1;
+            Complex proposal;
+            if ( unit(generator) < jumpProbability )
+                proposal = direct();
+            else {
+                double r = largeStep*std::exp(-std::log(largeStep/smallStep)*unit(generator));
+                double angle = 2.*pi*unit(generator);
+                proposal = Complex( c.re + r*std::cos(angle), c.im + r*std::sin(angle) );
+            }
+            evaluate(proposal, proposalHits);
+            if ( !proposalHits.empty() ) {
+                double ratio = ( proposalHits.size()*directDensity(proposal)*proposalDensity(proposal, c) )/
+                               ( hits.size()*directDensity(c)*proposalDensity(c, proposal) );
+                if ( unit(generator) < ratio ) {
+                    deposit();
+                    hits.swap(proposalHits);
+                    c = proposal;
+                    stay = 0.;
+                    nbAccepted += 1;
+                }
+            }
+            stay += 1.;
         }
-        i ++;
-     }
+        if ( !hits.empty() ) deposit();
+    }
+    privates.erase(std::remove_if(privates.begin(), privates.end(),
+                                  [] ( const std::vector<double>& h ) { return h.empty(); }),
+                   privates.end());
+    treeReduce(privates);
+    if ( nbEvaluations ) *nbEvaluations = nbEvals;
+    if ( acceptance ) *acceptance = ( nbSteps > 0 ? double(nbAccepted)/nbSteps : 0. );
+    return std::move(privates[0]);
 }
-// Bhuddabrot to test the chronometer
-// ---------------------------------------------------------------------
-std::vector<unsigned>
-bhuddabrot ( unsigned long nbSamples, unsigned long maxIter, unsigned width, unsigned height )
+
+// Distance L1 entre deux images normalisées (somme 1)
+template<typename Image1, typename Image2>
+double normalizedDistance( const Image1& a, const Image2& b )
 {
-    std::cerr << "Entring in Bhudda brot\n";
-    std::random_device rd;
-    std::mt19937 generator1(rd());
-    std::mt19937 generator2(rd());
-    
-    std::uniform_real_distribution<float> normDistrib(0.,2.);
-    auto genNorm = std::bind( normDistrib, generator1 );
-    std::uniform_real_distribution<float> angleDistrib(0.,
-                                                     6.283185307179586);
-    auto genAngle = std::bind( angleDistrib, generator2 );
-
-    std::cerr << "Computing starting c\n";
-    std::vector<unsigned> image(width*height, 0U);
- #  pragma omp parallel for schedule(dynamic,1000)
-    for ( unsigned long iSample = 0; iSample < nbSamples; iSample++) {
-	bool is_divergent;
-	do
-	{
-          float r = genNorm();
-          float angle = genAngle();
-          Complex c{ r * std::cos(angle), r * std::sin(angle) };
-          Complex c0{c.re,c.im};
-	  is_divergent = test_mandelbrot_divergent( maxIter, c0); 
-          if ( is_divergent == true ) {
-              // Calcul de l'orbite si la suite diverge :
-              comp_mandelbrot_orbit( maxIter, c0, width, height, image );
-	  } 
-	} while (is_divergent==false);
+    double sa = 0., sb = 0., dist = 0.;
+    for ( std::size_t k = 0; k < a.size(); ++k ) { sa += a[k]; sb += b[k]; }
+    for ( std::size_t k = 0; k < a.size(); ++k ) dist += std::abs(a[k]/sa - b[k]/sb);
+    return dist;
+}
+
+// Convergence comparée du tirage direct et de Metropolis-Hastings à temps
+// égal : deux calculs indépendants de chaque méthode, le bruit étant la
+// distance entre eux (l'erreur de chacun, à un facteur sqrt(2) près). Le
+// bruit décroît comme 1/sqrt(nombre d'orbites), d'où le nombre d'orbites
+// que le tirage direct aurait dû tester pour atteindre le même bruit.
+void benchMetropolis( unsigned long maxIter, unsigned long nbSamples, std::uint64_t seed )
+{
+    const unsigned width = 768U, height = 1024U;
+    Histogram uniform[2];
+    std::vector<double> metropolis[2];
+    unsigned long evalsUniform[2], evalsMetropolis[2];
+    double acceptance[2], time = 0.;
+    for ( int run = 0; run < 2; ++run ) {
+        std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+        uniform[run] = bhuddabrot( nbSamples, maxIter, width, height, private_histogram, seed + run,
+                                   false, &evalsUniform[run] );
+        std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+        time += 0.5*elapsed.count();
     }
-    return image;
+    for ( int run = 0; run < 2; ++run )
+        metropolis[run] = bhuddabrotMetropolis( time, maxIter, width, height, seed + run,
+                                                &evalsMetropolis[run], &acceptance[run] );
+    double noiseUniform = normalizedDistance(uniform[0], uniform[1]);
+    double noiseMetropolis = normalizedDistance(metropolis[0], metropolis[1]);
+    std::cout << "Temps par calcul : " << time << " s, maxIter = " << maxIter << std::endl;
+    std::cout << "Tirage direct : " << evalsUniform[0] << " orbites testées, bruit (distance L1) : "
+              << noiseUniform << std::endl;
+    std::cout << "Metropolis : " << evalsMetropolis[0] << " orbites testées, acceptation "
+              << 100.*acceptance[0] << "%, bruit : " << noiseMetropolis << std::endl;
+    double gain = (noiseUniform/noiseMetropolis)*(noiseUniform/noiseMetropolis);
+    std::cout << "Même bruit en " << 1./gain << " fois le temps du tirage direct, avec "
+              << double(evalsMetropolis[0])/(gain*evalsUniform[0])
+              << " fois ses orbites testées" << std::endl;
+    // Les deux méthodes doivent converger vers la même image
+    std::vector<double> meanUniform(uniform[0].size()), meanMetropolis(uniform[0].size());
+    double su0 = 0., su1 = 0., sm0 = 0., sm1 = 0.;
+    for ( std::size_t k = 0; k < meanUniform.size(); ++k ) {
+        su0 += uniform[0][k]; su1 += uniform[1][k];
+        sm0 += metropolis[0][k]; sm1 += metropolis[1][k];
+    }
+    for ( std::size_t k = 0; k < meanUniform.size(); ++k ) {
+        meanUniform[k]    = uniform[0][k]/su0 + uniform[1][k]/su1;
+        meanMetropolis[k] = metropolis[0][k]/sm0 + metropolis[1][k]/sm1;
+    }
+    std::cout << "Distance entre les images moyennes des deux méthodes : "
+              << normalizedDistance(meanUniform, meanMetropolis) << std::endl;
 }
 
-void save_image( const std::string &filename, unsigned width, unsigned height, const std::vector<unsigned char> &img )
+// Débit (échantillons retenus, c testés par seconde) de la boucle directe
+// (bhuddabrot) et du pipeline en deux phases (bhuddabrotChannels, une
+// couche), test d'échappement scalaire puis vectoriel. Les deux versions
+// du pipeline doivent donner la même image.
+void benchThroughput( unsigned long maxIter, unsigned long nbSamples, std::uint64_t seed )
 {
-    std::ofstream ofs( filename.c_str(), std::ios::out | std::ios::binary );
-    ofs << "P6\n"
-        << width << " " << height << "\n255\n";
-    for ( unsigned i = 0; i < width * height; ++i ) {
-        ofs << img[ 4 * i + 0 ] << img[ 4 * i + 1 ] << img[ 4 * i + 2 ];
+    const unsigned width = 768U, height = 1024U;
+    const std::vector<Channel> channel = { {nbSamples, maxIter} };
+    const char* names[3] = { "boucle directe", "deux phases, scalaire", "deux phases, SIMD" };
+    Histogram images[3];
+    double times[3];
+    for ( int version = 0; version < 3; ++version ) {
+        unsigned long nbEvals = 0;
+        std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+        if ( version == 0 )
+            images[0] = bhuddabrot( nbSamples, maxIter, width, height, private_histogram, seed, false,
+                                    &nbEvals );
+        else
+            images[version] = bhuddabrotChannels( channel, width, height, private_histogram, seed,
+                                                  &nbEvals, version == 2 )[0];
+        std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+        times[version] = elapsed.count();
+        std::cout << names[version] << " : " << times[version] << " s, " << nbSamples/times[version]
+                  << " échantillons/s, " << nbEvals/times[version] << " c testés/s, accélération "
+                  << times[0]/times[version] << std::endl;
     }
-    ofs.close();
+    std::cout << "Distance entre les images scalaire et SIMD : " << normalizedDistance(images[1], images[2])
+              << ", entre boucle directe et SIMD (tirages différents) : "
+              << normalizedDistance(images[0], images[2]) << std::endl;
 }
 
+// Extensibilité de chaque accumulation, de 1 à maxThreads threads (par
+// puissances de 2) sur un même calcul réduit : temps, accélération par
+// rapport à 1 thread et rapport au temps de la version atomic
+void benchScaling( int maxThreads, std::uint64_t seed )
+{
+    const unsigned width = 768U, height = 1024U;
+    const unsigned long nbSamples = 1000000, maxIter = 20000;
+    const histogram_mode modes[3] = { atomic_histogram, private_histogram, tiled_histogram };
+    double sequential[3] = { 0., 0., 0. };
+    for ( int nbThreads = 1; nbThreads <= maxThreads; nbThreads *= 2 ) {
+        omp_set_num_threads(nbThreads);
+        double atomicTime = 0.;
+        for ( int m = 0; m < 3; ++m ) {
+            std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+            bhuddabrot( nbSamples, maxIter, width, height, modes[m], seed, false );
+            std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+            double t = elapsed.count();
+            if ( nbThreads == 1 ) sequential[m] = t;
+            if ( m == 0 ) atomicTime = t;
+            std::cout << nbThreads << " threads, " << histogramModeName(modes[m]) << " : " << t
+                      << " s, accélération " << sequential[m]/t << ", temps atomic/temps "
+                      << atomicTime/t << std::endl;
+        }
+    }
+}
 
-int main()
+// Vérifie qu'aucun point des cellules marquées ne diverge : points tirés
+// dans le masque, itérés en double sans détection de cycle jusqu'à
+// maxIter. Puis temps du test de divergence de tirages directs avec et
+// sans le masque.
+void checkInteriorMask( const InteriorMask& mask, int maxIter, std::uint64_t seed )
 {
+    const std::size_t nbPoints = 100000;
+    std::vector<double> points = mask.samplePoints(nbPoints, seed);
+    unsigned long nbEscaping = 0;
+ #  pragma omp parallel for reduction(+:nbEscaping) schedule(dynamic, 64)
+    for ( long k = 0; k < long(points.size()/2); ++k ) {
+        double cr = points[2*k], ci = points[2*k+1], zr = 0., zi = 0.;
+        for ( int n = 0; n < maxIter; ++n ) {
+            double t = zr*zr - zi*zi + cr;
+            zi = 2.*zr*zi + ci;
+            zr = t;
+            if ( zr*zr + zi*zi > 4. ) { nbEscaping += 1; break; }
+        }
+    }
+    std::cout << points.size()/2 << " points du masque itérés " << maxIter << " fois : "
+              << nbEscaping << " divergent" << std::endl;
+
+    const unsigned long nbDraws = 1000000, testIter = 1000000;
+    const Philox4x32 philox(seed);
+    unsigned long nbInMask = 0;
+    for ( int withMask = 0; withMask < 2; ++withMask ) {
+        interiorMask = ( withMask ? &mask : nullptr );
+        unsigned long nbDivergent = 0;
+        std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+ #      pragma omp parallel for reduction(+:nbDivergent,nbInMask) schedule(dynamic, 1000)
+        for ( unsigned long i = 0; i < nbDraws; ++i ) {
+            Complex c = sample_point( philox, i, 0 );
+            if ( withMask && mask.contains(c.re, c.im) ) nbInMask += 1;
+            if ( test_mandelbrot_divergent( testIter, c ) ) nbDivergent += 1;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+        std::cout << nbDraws << " tirages testés (maxIter = " << testIter << ") "
+                  << ( withMask ? "avec" : "sans" ) << " le masque : " << elapsed.count() << " s, "
+                  << nbDivergent << " divergent" << std::endl;
+    }
+    interiorMask = nullptr;
+    std::cout << "  dont " << nbInMask << " dans le masque" << std::endl;
+}
+
+int main( int argc, char* argv[] )
+{
+    // Accumulation optionnelle : private (défaut), atomic ou tiled (voir
+    // BuddhaHistogram.hpp) ; "scaling [maxThreads]" compare les trois de 1
+    // à maxThreads threads. "metropolis [secondes]" calcule chaque image
+    // par Metropolis-Hastings (2 s par image par défaut) ; "convergence
+    // [maxIter] [nbSamples]" compare le bruit des deux tirages à temps égal.
+    // "onepass" après le mode d'accumulation calcule les trois couches en
+    // une seule passe (bhuddabrotChannels, test d'échappement SIMD) ;
+    // "throughput [maxIter] [nbSamples]" compare son débit scalaire et SIMD
+    // à celui de la boucle directe. "mask [maxIter]" vérifie le masque
+    // intérieur. N'importe où : "--seed s" fixe la graine des tirages
+    // (aléatoire sinon) pour reproduire une image, "--nomask" et
+    // "--nosymmetry" désactivent le masque intérieur et la symétrie.
+    std::uint64_t seed = std::random_device()();
+    bool useMask = true;
+    std::vector<std::string> args;
+    for ( int i = 1; i < argc; ++i ) {
+        std::string option(argv[i]);
+        if ( (option == "--seed") && (i+1 < argc) ) seed = std::stoull(argv[++i]);
+        else if ( option == "--nomask" ) useMask = false;
+        else if ( option == "--nosymmetry" ) useSymmetry = false;
+        else args.push_back(option);
+    }
+    std::cout << "Graine : " << seed << std::endl;
+    const std::size_t nargs = args.size();
+    std::string arg = ( nargs > 0 ? args[0] : "private" );
+    InteriorMask mask;
+    if ( useMask || arg == "mask" ) mask = cachedInteriorMask("interior_mask.bin");
+    if ( arg == "mask" ) {
+        checkInteriorMask( mask, nargs > 1 ? std::stoi(args[1]) : 10000, seed );
+        return EXIT_SUCCESS;
+    }
+    if ( useMask ) interiorMask = &mask;
+    if ( arg == "scaling" ) {
+        benchScaling( nargs > 1 ? std::stoi(args[1]) : omp_get_max_threads(), seed );
+        return EXIT_SUCCESS;
+    }
+    if ( arg == "throughput" ) {
+        benchThroughput( nargs > 1 ? std::stoul(args[1]) : 20000, nargs > 2 ? std::stoul(args[2]) : 2000000,
+                         seed );
+        return EXIT_SUCCESS;
+    }
+    if ( arg == "convergence" ) {
+        benchMetropolis( nargs > 1 ? std::stoul(args[1]) : 1000000, nargs > 2 ? std::stoul(args[2]) : 2000000,
+                         seed );
+        return EXIT_SUCCESS;
+    }
+    const bool metropolis = ( arg == "metropolis" );
+    const double timeBudget = ( metropolis && nargs > 1 ? std::stod(args[1]) : 2. );
+    const bool onePass = ( !metropolis && nargs > 1 && args[1] == "onepass" );
+    histogram_mode mode = histogramModeFromName(arg);
+    std::cout << "Accumulation : " << ( metropolis ? "metropolis" : histogramModeName(mode) ) << std::endl;
     unsigned width = 768U, height = 1024U;
     std::cerr << "Starting program\n";
     std::chrono::time_point<std::chrono::system_clock> start, end;
@@ -135,57 +779,41 @@ int main()
     
     const unsigned long l1 = 20000, l2 = 100000, l3 = 1000000;
     //const unsigned long l1 = 2000, l2 = 10000, l3 = 10000;
-    std::cerr << "Bhudda 1\n";
-    start = std::chrono::system_clock::now();
-    auto buddha1 = bhuddabrot( 15000000, l1, width, height );
-    end = std::chrono::system_clock::now();
-    elapsed_seconds = end-start;
-    std::cout << "Temps calcul Bhudda 1 : " << elapsed_seconds.count() 
-              << std::endl;
-
-    std::cerr << "Bhudda 2\n";
-    start = std::chrono::system_clock::now();
-    auto buddha2 = bhuddabrot( 5000000, l2, width, height );
-    end = std::chrono::system_clock::now();
-    elapsed_seconds = end-start;
-    std::cout << "Temps calcul Bhudda 2 : " << elapsed_seconds.count() 
-              << std::endl;
-    std::cerr << "Bhudda 3\n";
-    start = std::chrono::system_clock::now();
-    auto buddha3 = bhuddabrot( 300000, l3, width, height );
-    end = std::chrono::system_clock::now();
-    elapsed_seconds = end-start;
-    std::cout << "Temps calcul Bhudda 3 : " << elapsed_seconds.count() 
-              << std::endl;
-    std::cerr << "Preparing the image\n";
-    std::vector<unsigned char> image(4*width*height);
-    start = std::chrono::system_clock::now();
-    float b1, b2, b3;
-    b1 = 0; b2 = 0; b3 = 0;
-#pragma omp parallel for collapse(2)
-    for ( unsigned i = 0; i < height; ++i ) {
-        for (unsigned j = 0; j < width; ++j ) {
-            unsigned long ind = i*width+j;
-            b1 += buddha1[ind];
-            b2 += buddha2[ind];
-            b3 += buddha3[ind];
+    const std::vector<Channel> channels = { {15000000, l1}, {5000000, l2}, {300000, l3} };
+    std::vector<std::vector<double>> layers;
+    if ( onePass ) {
+        // "onepass" en deuxième argument : les trois couches en une passe
+        std::cerr << "Bhudda 1, 2 et 3\n";
+        start = std::chrono::system_clock::now();
+        std::vector<Histogram> counts = bhuddabrotChannels( channels, width, height, mode, seed );
+        for ( const Histogram& h : counts ) layers.emplace_back(h.begin(), h.end());
+        end = std::chrono::system_clock::now();
+        elapsed_seconds = end-start;
+        std::cout << "Temps calcul Bhudda 1, 2 et 3 en une passe : " << elapsed_seconds.count()
+                  << std::endl;
+    } else {
+        // Une graine par couche, pour des couches indépendantes
+        for ( std::size_t k = 0; k < channels.size(); ++k ) {
+            std::cerr << "Bhudda " << k+1 << "\n";
+            start = std::chrono::system_clock::now();
+            // nbSamples tirages directs, ou timeBudget secondes de Metropolis-Hastings
+            if ( metropolis )
+                layers.push_back(bhuddabrotMetropolis( timeBudget, channels[k].maxIter, width, height,
+                                                       seed + k ));
+            else {
+                Histogram counts = bhuddabrot( channels[k].nbSamples, channels[k].maxIter, width, height,
+                                               mode, seed + k );
+                layers.emplace_back(counts.begin(), counts.end());
+            }
+            end = std::chrono::system_clock::now();
+            elapsed_seconds = end-start;
+            std::cout << "Temps calcul Bhudda " << k+1 << " : " << elapsed_seconds.count()
+                      << std::endl;
         }
     }
-    unsigned long stride = width*height;
-    float scal1 = 16.*stride/b1;
-    float scal2 = 16.*stride/b2;
-    float scal3 = 16.*stride/b3;
-#pragma omp parallel for collapse(2)
-    for ( unsigned i = 0; i < height; ++i ) {
-        for (unsigned j = 0; j < width; ++j ) {
-            unsigned long ind = i*width+j;
-            image[ 4*ind   ] = std::min(unsigned(buddha1[ind]*scal1),255U);
-            image[ 4*ind+1 ] = std::min(unsigned(buddha2[ind]*scal2),255U);
-            image[ 4*ind+2 ] = std::min(unsigned(buddha3[ind]*scal3),255U);
-            image[ 4*ind+3 ] = 255;
-        }
-    }    
-    save_image("bhuddabrot.ppm", width, height, image);
+    std::cerr << "Preparing the image\n";
+    start = std::chrono::system_clock::now();
+    save_image("bhuddabrot.ppm", width, height, bhuddabrot_image( width, height, layers ));
     end = std::chrono::system_clock::now();
     elapsed_seconds = end-start;
     std::cout << "Temps Sauvegarde image : " << elapsed_seconds.count() 
@@ -0,0 +1,345 @@
+// Bhuddabrot distribué : MPI entre les processus, OpenMP dans chacun
+# include <algorithm>
+# include <cmath>
+# include <cstdlib>
+# include <iostream>
+# include <random>
+# include <string>
+# include <vector>
+# include <omp.h>
+# include <mpi.h>
+# include "BuddhaHistogram.hpp"
+# include "BuddhaKernel.hpp"
+# include "InteriorMask.hpp"
+# include "Philox.hpp"
+
+MPI_Comm globComm;
+
+/** Répartition dynamique des échantillons.
+ *
+ *  Chaque couche (nbSamples orbites de seuil maxIter, graine seed) est
+ *  découpée en nbUnits tranches d'échantillons consécutifs ; l'unité de
+ *  travail u est formée de la tranche u de chaque couche, si bien que
+ *  toutes les couches avancent au même rythme et que les unités ont à peu
+ *  près le même coût. Le numéro de la prochaine unité est un compteur du
+ *  processus 0, exposé dans une fenêtre MPI et pris par MPI_Fetch_and_op
+ *  (comme le vol de travail de TP2/Sources/Mandelbrot_mpi.cpp) : un
+ *  processus plus rapide prend simplement plus d'unités, sans maître.
+ *  Un échantillon ne dépend que de la graine et de son numéro (voir
+ *  sample_point) : l'image est celle de bhudda.exe pour la même graine,
+ *  quel que soit le nombre de processus.
+ *
+ *  Réductions périodiques : les repères marks[r] = nbUnits*(r+1)/nbSnapshots
+ *  découpent les unités. Un processus qui reçoit une unité u >= marks[r]
+ *  a fini toutes ses unités d'avant le repère : il lance alors la
+ *  réduction r (MPI_Ireduce, non bloquante) de ses histogrammes vers le
+ *  processus 0 et continue à calculer pendant qu'elle avance. L'image
+ *  réduite r est donc exactement celle des marks[r] premières unités ; le
+ *  processus 0 l'écrit (bhuddabrot_snapshot.ppm) avec son écart à la
+ *  précédente, pour arrêter le calcul quand l'image ne bouge plus.
+ **/
+struct Layer
+{
+    unsigned long nbSamples, maxIter;
+    std::uint64_t seed;
+};
+
+namespace {
+    // Accumulateur dans une couche d'un histogramme privé de couches mises
+    // bout à bout (même interface que PrivateAccumulator)
+    struct LayerAccumulator
+    {
+        Count* image;
+        void add( std::size_t ind ) { image[ind] += 1; }
+    };
+
+    // Premier tirage de la tranche u d'une couche de nbDraws tirages
+    std::uint64_t unitFirstDraw( std::uint64_t nbDraws, long u, long nbUnits )
+    {
+        return nbDraws*std::uint64_t(u)/std::uint64_t(nbUnits);
+    }
+
+    // Distance L1 entre deux couches normalisées (somme 1)
+    double normalizedDistance( const Count* a, const Count* b, std::size_t size )
+    {
+        double sa = 0., sb = 0., dist = 0.;
+        for ( std::size_t k = 0; k < size; ++k ) { sa += a[k]; sb += b[k]; }
+        if ( (sa == 0.) || (sb == 0.) ) return 2.;
+        for ( std::size_t k = 0; k < size; ++k ) dist += std::abs(a[k]/sa - b[k]/sb);
+        return dist;
+    }
+
+    // Image des couches mises bout à bout dans counts
+    std::vector<unsigned char> layersImage( unsigned width, unsigned height, std::size_t nbLayers,
+                                            const Histogram& counts )
+    {
+        const std::size_t size = std::size_t(width)*height;
+        std::vector<std::vector<double>> layers(nbLayers);
+        for ( std::size_t k = 0; k < nbLayers; ++k )
+            layers[k].assign(counts.begin() + k*size, counts.begin() + (k+1)*size);
+        return bhuddabrot_image(width, height, layers);
+    }
+}
+
+/** Réductions non bloquantes des histogrammes vers le processus 0 : au
+ *  plus une en cours, une nouvelle attend la fin de la précédente (toutes
+ *  doivent être lancées dans le même ordre par tous les processus). Le
+ *  processus 0 écrit chaque image réduite dès qu'elle est complète.
+ **/
+class SnapshotReducer
+{
+public:
+    SnapshotReducer( unsigned width, unsigned height, std::size_t nbLayers, int nbSnapshots ) :
+        m_width(width), m_height(height), m_nbLayers(nbLayers), m_nbSnapshots(nbSnapshots),
+        m_rank(0), m_index(-1), m_request(MPI_REQUEST_NULL), m_waitTime(0.), m_lastChange(2.),
+        m_send(), m_recv(), m_previous()
+    {
+        MPI_Comm_rank(globComm, &m_rank);
+        const std::size_t total = nbLayers*width*height;
+        m_send.assign(total, 0);
+        if ( m_rank == 0 ) m_recv.assign(total, 0);
+    }
+
+    /** Lance la réduction index de counts (copié : le calcul continue) */
+    void start( int index, const std::vector<Histogram>& privates )
+    {
+        wait();
+        const long total = long(m_send.size());
+        const int nbHists = int(privates.size());
+        Count* send = m_send.data();
+#       pragma omp parallel for schedule(static)
+        for ( long k = 0; k < total; ++k ) {
+            Count sum = 0;
+            for ( int t = 0; t < nbHists; ++t )
+                if ( !privates[t].empty() ) sum += privates[t][k];
+            send[k] = sum;
+        }
+        m_index = index;
+        MPI_Ireduce(m_send.data(), m_recv.data(), int(total), MPI_UINT64_T, MPI_SUM, 0, globComm, &m_request);
+    }
+
+    /** Fait avancer la réduction en cours ; vrai si elle est finie */
+    bool poll()
+    {
+        if ( m_request == MPI_REQUEST_NULL ) return true;
+        int flag;
+        MPI_Test(&m_request, &flag, MPI_STATUS_IGNORE);
+        if ( flag ) completed();
+        return flag != 0;
+    }
+
+    /** Attend la fin de la réduction en cours */
+    void wait()
+    {
+        if ( m_request == MPI_REQUEST_NULL ) return;
+        double start = MPI_Wtime();
+        MPI_Wait(&m_request, MPI_STATUS_IGNORE);
+        m_waitTime += MPI_Wtime() - start;
+        completed();
+    }
+
+    /** Image complète (processus 0, après la dernière réduction) */
+    const Histogram& counts() const { return m_recv; }
+    double waitTime() const { return m_waitTime; }
+    /** Écart L1 moyen par couche entre les deux dernières images */
+    double lastChange() const { return m_lastChange; }
+private:
+    void completed()
+    {
+        if ( m_rank != 0 ) return;
+        const std::size_t size = std::size_t(m_width)*m_height;
+        if ( !m_previous.empty() ) {
+            m_lastChange = 0.;
+            for ( std::size_t k = 0; k < m_nbLayers; ++k )
+                m_lastChange += normalizedDistance(m_recv.data() + k*size, m_previous.data() + k*size, size);
+            m_lastChange /= m_nbLayers;
+        }
+        m_previous = m_recv;
+        save_image("bhuddabrot_snapshot.ppm", m_width, m_height,
+                   layersImage(m_width, m_height, m_nbLayers, m_recv));
+        std::cout << "Image " << m_index + 1 << "/" << m_nbSnapshots << " ("
+                  << 100.*(m_index + 1)/m_nbSnapshots << "% des unités)";
+        if ( m_index > 0 ) std::cout << ", écart à la précédente : " << m_lastChange;
+        std::cout << std::endl;
+    }
+
+    unsigned m_width, m_height;
+    std::size_t m_nbLayers;
+    int m_nbSnapshots, m_rank, m_index;
+    MPI_Request m_request;
+    double m_waitTime, m_lastChange;
+    Histogram m_send, m_recv, m_previous; // m_recv et m_previous : processus 0
+};
+
+/** Calcule les couches (voir plus haut) ; renvoie sur le processus 0 leurs
+ *  histogrammes mis bout à bout (vide sur les autres). Avec tolerance > 0,
+ *  le processus 0 arrête la distribution des unités dès qu'une image
+ *  réduite s'écarte de moins de tolerance de la précédente. **/
+Histogram
+bhuddabrotDistributed( const std::vector<Layer>& layers, unsigned width, unsigned height, long nbUnits,
+                       int nbSnapshots, double tolerance )
+{
+    int rank, nbp;
+    MPI_Comm_rank(globComm, &rank);
+    MPI_Comm_size(globComm, &nbp );
+    const std::size_t size = std::size_t(width)*height, nbLayers = layers.size();
+    std::vector<Philox4x32> philox;
+    std::vector<std::uint64_t> nbDraws;
+    for ( const Layer& layer : layers ) {
+        philox.emplace_back(layer.seed);
+        nbDraws.push_back( useSymmetry ? (layer.nbSamples + 1)/2 : layer.nbSamples );
+    }
+    std::vector<long> marks(nbSnapshots);
+    for ( int r = 0; r < nbSnapshots; ++r ) marks[r] = nbUnits*(r+1)/nbSnapshots;
+
+    // Compteur des unités distribuées, dans la mémoire du processus 0
+    long* next;
+    MPI_Win win;
+    MPI_Win_allocate(( rank == 0 ? sizeof(long) : 0 ), sizeof(long), MPI_INFO_NULL, globComm, &next, &win);
+    if ( rank == 0 ) *next = 0;
+    MPI_Barrier(globComm);
+    MPI_Win_lock_all(0, win);
+    double commTime = 0.;
+    auto fetch = [&] ( long value, MPI_Op op ) {
+        double start = MPI_Wtime();
+        long old;
+        MPI_Fetch_and_op(&value, &old, MPI_LONG, 0, 0, op, win);
+        MPI_Win_flush(0, win);
+        commTime += MPI_Wtime() - start;
+        return old;
+    };
+
+    // Un histogramme par thread et par couche (couches bout à bout), alloué
+    // par son thread
+    std::vector<Histogram> privates(omp_get_max_threads());
+    SnapshotReducer reducer(width, height, nbLayers, nbSnapshots);
+    unsigned long nbUnitsDone = 0, nbEvaluations = 0;
+    std::uint64_t nbDrawsDone = 0;
+    double computeTime = 0.;
+    bool stopped = false;
+    int nextMark = 0;
+    double start = MPI_Wtime();
+    while ( true ) {
+        const long u = fetch(1, MPI_SUM);
+        // Toutes mes unités d'avant les repères franchis sont faites
+        for ( ; (nextMark < nbSnapshots) && (u >= marks[nextMark]); ++nextMark ) {
+            double t0 = MPI_Wtime();
+            reducer.start(nextMark, privates);
+            commTime += MPI_Wtime() - t0;
+        }
+        if ( u >= nbUnits ) break;
+        double t0 = MPI_Wtime();
+        unsigned long nbEvals = 0;
+#       pragma omp parallel reduction(+:nbEvals)
+        {
+            Histogram& own = privates[omp_get_thread_num()];
+            if ( own.empty() ) own.assign(nbLayers*size, 0);
+            for ( std::size_t k = 0; k < nbLayers; ++k ) {
+                LayerAccumulator layerAcc{ own.data() + k*size };
+                const std::uint64_t first = unitFirstDraw(nbDraws[k], u, nbUnits);
+                const std::uint64_t last  = unitFirstDraw(nbDraws[k], u + 1, nbUnits);
+#               pragma omp for schedule(dynamic) nowait
+                for ( std::uint64_t iSample = first; iSample < last; ++iSample )
+                    nbEvals += sample_orbit( iSample, layers[k].maxIter, width, height, philox[k], layerAcc );
+            }
+        }
+        computeTime += MPI_Wtime() - t0;
+        nbEvaluations += nbEvals;
+        nbUnitsDone += 1;
+        for ( std::size_t k = 0; k < nbLayers; ++k )
+            nbDrawsDone += unitFirstDraw(nbDraws[k], u + 1, nbUnits) - unitFirstDraw(nbDraws[k], u, nbUnits);
+        t0 = MPI_Wtime();
+        reducer.poll();
+        commTime += MPI_Wtime() - t0;
+        if ( (rank == 0) && (tolerance > 0.) && !stopped && (reducer.lastChange() < tolerance) ) {
+            // Plus aucune unité ne sera distribuée
+            fetch(nbUnits, MPI_MAX);
+            stopped = true;
+            std::cout << "Image stable (écart < " << tolerance << ") : arrêt après " << u + 1
+                      << " unités distribuées" << std::endl;
+        }
+    }
+    reducer.wait();
+    double elapsed = MPI_Wtime() - start;
+    MPI_Win_unlock_all(win);
+    MPI_Win_free(&win);
+
+    // Bilan par processus : unités, tirages, temps de calcul et de
+    // communication (prise d'unités et réductions, attente comprise ; pour le
+    // processus 0, écriture des images intermédiaires comprise)
+    double stats[6] = { double(nbUnitsDone), double(nbDrawsDone), double(nbEvaluations), computeTime,
+                        commTime + reducer.waitTime(), elapsed };
+    std::vector<double> allStats( rank == 0 ? 6*nbp : 0 );
+    MPI_Gather(stats, 6, MPI_DOUBLE, allStats.data(), 6, MPI_DOUBLE, 0, globComm);
+    if ( rank == 0 ) {
+        double totalDraws = 0., maxElapsed = 0.;
+        for ( int p = 0; p < nbp; ++p ) {
+            const double* s = &allStats[6*p];
+            std::cout << "  Processus " << p << " : " << s[0] << " unités, " << s[1] << " tirages, "
+                      << s[2] << " c testés, calcul " << s[3] << " s, communication " << s[4] << " s"
+                      << std::endl;
+            totalDraws += s[1];
+            maxElapsed = std::max(maxElapsed, s[5]);
+        }
+        std::cout << nbp << " processus de " << omp_get_max_threads() << " threads : " << maxElapsed
+                  << " s, " << (useSymmetry ? 2. : 1.)*totalDraws/maxElapsed << " échantillons/s" << std::endl;
+    }
+    return ( rank == 0 ? reducer.counts() : Histogram() );
+}
+
+int main( int argc, char* argv[] )
+{
+    // Seul le thread principal de chaque processus fait des appels MPI
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_dup(MPI_COMM_WORLD, &globComm);
+    int rank;
+    MPI_Comm_rank(globComm, &rank);
+    // Options : "--seed s" (graine, aléatoire sinon), "--scale f" (nombres
+    // d'échantillons multipliés par f, pour des essais ou une étude
+    // d'extensibilité), "--units n" (unités de travail, 1024 par défaut),
+    // "--snapshots n" (réductions intermédiaires, 16 par défaut),
+    // "--tolerance eps" (arrêt dès qu'une image s'écarte de moins de eps de
+    // la précédente), "--nomask" et "--nosymmetry" (voir bhudda.cpp).
+    std::uint64_t seed = 0;
+    bool randomSeed = true, useMask = true;
+    double scale = 1., tolerance = 0.;
+    long nbUnits = 1024;
+    int nbSnapshots = 16;
+    for ( int i = 1; i < argc; ++i ) {
+        std::string option(argv[i]);
+        if ( (option == "--seed") && (i+1 < argc) ) { seed = std::stoull(argv[++i]); randomSeed = false; }
+        else if ( (option == "--scale") && (i+1 < argc) ) scale = std::stod(argv[++i]);
+        else if ( (option == "--units") && (i+1 < argc) ) nbUnits = std::stol(argv[++i]);
+        else if ( (option == "--snapshots") && (i+1 < argc) ) nbSnapshots = std::stoi(argv[++i]);
+        else if ( (option == "--tolerance") && (i+1 < argc) ) tolerance = std::stod(argv[++i]);
+        else if ( option == "--nomask" ) useMask = false;
+        else if ( option == "--nosymmetry" ) useSymmetry = false;
+    }
+    nbSnapshots = std::max(1, std::min<int>(nbSnapshots, int(nbUnits)));
+    if ( randomSeed && (rank == 0) ) seed = std::random_device()();
+    MPI_Bcast(&seed, 1, MPI_UINT64_T, 0, globComm);
+    if ( rank == 0 ) std::cout << "Graine : " << seed << std::endl;
+    // Le processus 0 construit le masque s'il n'est pas encore sur disque,
+    // les autres le lisent ensuite
+    InteriorMask mask;
+    if ( useMask ) {
+        if ( rank == 0 ) mask = cachedInteriorMask("interior_mask.bin");
+        MPI_Barrier(globComm);
+        if ( rank != 0 ) mask = cachedInteriorMask("interior_mask.bin", 2048, false);
+        interiorMask = &mask;
+    }
+    const unsigned width = 768U, height = 1024U;
+    const unsigned long l1 = 20000, l2 = 100000, l3 = 1000000;
+    // Mêmes couches et graines que bhudda.exe (seed + k pour la couche k)
+    std::vector<Layer> layers = { {15000000, l1, seed}, {5000000, l2, seed + 1}, {300000, l3, seed + 2} };
+    for ( Layer& layer : layers ) layer.nbSamples = (unsigned long)(scale*layer.nbSamples);
+
+    Histogram counts = bhuddabrotDistributed( layers, width, height, nbUnits, nbSnapshots, tolerance );
+    if ( rank == 0 ) {
+        save_image("bhuddabrot.ppm", width, height, layersImage(width, height, layers.size(), counts));
+        std::cout << "Image sauvée dans bhuddabrot.ppm" << std::endl;
+    }
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
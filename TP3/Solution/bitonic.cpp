@@ -1,5 +1,4 @@
 # include <algorithm>
-# include <utility>
 # include <vector>
 # include <iostream>
 # include <functional>
@@ -8,54 +7,94 @@
 # include <exception>
 # include <chrono>
 # include <stdexcept>
+# include <string>
+# include <omp.h>
+# include "Bitonic.hpp"
 # include "Vecteur.hpp"
 using namespace Algebra;
 
-// Tri Parallèle Bitonic
-namespace Bitonic
+// Tri de data en séquentiel puis avec les tâches, avec l'accélération
+template<typename Obj> void
+benchSort( const std::string& name, const std::vector<Obj>& data )
 {
-  template<typename Obj>
-  void _compare( bool up, Obj* objs, int len )
-  {
-    int dist = len/2;
-    for ( int i = 0; i < dist; ++i ) {
-      if ( (objs[i] > objs[i+dist]) == up ) {
-	std::swap(objs[i],objs[i+dist]);
-      }
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    std::vector<Obj> seq(data), par(data);
+    start = std::chrono::system_clock::now();
+    Bitonic::sort(true, seq, int(seq.size()));
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> seq_seconds = end-start;
+    std::cout << "Temps calcul tri sur les " << name << " (séquentiel) : " << seq_seconds.count()
+              << std::endl;
+
+    start = std::chrono::system_clock::now();
+    Bitonic::sort(true, par);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> par_seconds = end-start;
+    std::cout << "Temps calcul tri sur les " << name << " (tâches, " << omp_get_max_threads()
+              << " threads) : " << par_seconds.count() << ", accélération : "
+              << seq_seconds.count()/par_seconds.count() << std::endl;
+    for ( size_t i = 1; i < par.size(); ++i ) {
+        if ( par[i] < par[i-1] ) {
+            throw std::logic_error("Erreur de tri pour les " + name + " !");
+        }
     }
-  }
-  // --------------------------------------------
-  template<typename Obj> std::pair<Obj*,int>
-  _merge( bool up, Obj* objs, int len )
-  {
-    if (len == 1) return std::make_pair(objs,len);
-    _compare(up,objs,len);
-    auto first  = _merge(up, objs, len/2);
-    auto second = _merge(up, objs+len/2, len-(len/2));
-    return std::make_pair(first.first, first.second + second.second);
-  }
-  // --------------------------------------------
-  template<typename Obj> std::pair<Obj*,int>
-  _sort( bool up, Obj* objs, int len )
-  {
-    if (len <= 1) return std::make_pair(objs,1);
-    auto first  = _sort(true , objs, len/2);
-    auto second = _sort(false, objs + len/2, len - (len/2));
-    return _merge(up, first.first, first.second + second.second );
-  }
-  // --------------------------------------------
-  template<typename Obj> std::vector<Obj>&
-  sort( bool up, std::vector<Obj>& x )
-  {
-    _sort(up, x.data(), int(x.size()));
-    return x;
-  }  
+    if ( par != seq ) throw std::logic_error("Tris séquentiel et parallèle différents pour les " + name + " !");
 }
 
-int main()
-{     
+// Tri séquentiel des réels : réseau SIMD, récursion scalaire, std::sort
+void
+benchBaseCase( const std::vector<double>& data )
+{
+    std::chrono::time_point<std::chrono::system_clock> start, end;
+    std::vector<double> net(data), scal(data), ref(data);
+    start = std::chrono::system_clock::now();
+    Bitonic::sort(true, net, int(net.size()));
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> net_seconds = end-start;
+    start = std::chrono::system_clock::now();
+    Bitonic::sort(true, scal, int(scal.size()), false);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> scal_seconds = end-start;
+    start = std::chrono::system_clock::now();
+    std::sort(ref.begin(), ref.end());
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> ref_seconds = end-start;
+    std::cout << "Tri séquentiel des entiers, réseau SIMD de " << Bitonic::blockLen << " : "
+              << net_seconds.count() << ", récursion scalaire : " << scal_seconds.count()
+              << ", std::sort : " << ref_seconds.count() << std::endl;
+    if ( (net != ref) || (scal != ref) ) throw std::logic_error("Erreur de tri du réseau SIMD !");
+}
+
+// Tri des vecteurs par clés (normes calculées une fois) contre le tri à tâches
+void
+benchKeySort( const std::vector<Vecteur>& data )
+{
     std::chrono::time_point<std::chrono::system_clock> start, end;
-    const size_t N = (1UL << 21);
+    std::vector<Vecteur> keyed(data), up(data), down(data);
+    start = std::chrono::system_clock::now();
+    Bitonic::sortByKeys(true, keyed);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> key_seconds = end-start;
+    start = std::chrono::system_clock::now();
+    Bitonic::sort(true, up);
+    end = std::chrono::system_clock::now();
+    std::chrono::duration<double> par_seconds = end-start;
+    std::cout << "Temps calcul tri sur les vecteurs par clés : " << key_seconds.count()
+              << ", accélération sur le tri à tâches : " << par_seconds.count()/key_seconds.count()
+              << std::endl;
+    Bitonic::sortByKeys(false, down);
+    for ( size_t i = 1; i < keyed.size(); ++i ) {
+        if ( (keyed[i] < keyed[i-1]) || (down[i] > down[i-1]) ) {
+            throw std::logic_error("Erreur de tri par clés pour les vecteurs !");
+        }
+    }
+    if ( keyed != up ) throw std::logic_error("Tris par clés et bitonique différents pour les vecteurs !");
+}
+
+int main( int nargs, char* vargs[] )
+{     
+    // Argument optionnel : log2 du nombre d'éléments à trier
+    const size_t N = (1UL << ( nargs > 1 ? std::stoi(vargs[1]) : 21 ));
     const size_t dim = 40;
     std::random_device rd;
     std::mt19937 generator1(rd());
@@ -69,17 +108,8 @@ int main()
     // Trie sur les entiers :
     std::vector<double> tab(N);
     for ( auto& x : tab ) x = genInt();
-    start = std::chrono::system_clock::now();
-    Bitonic::sort(true, tab);
-    end = std::chrono::system_clock::now();
-    std::chrono::duration<double> elapsed_seconds = end-start;
-    std::cout << "Temps calcul tri sur les entiers : " << elapsed_seconds.count() 
-              << std::endl;
-    for ( size_t i = 1; i < tab.size(); ++i ) {
-        if ( tab[i] < tab[i-1] ) {
-            throw std::logic_error("Erreur de tri pour les entiers !");
-        }
-    }
+    benchSort("entiers", tab);
+    benchBaseCase(tab);
   
     // Trie sur les vecteurs :
     std::vector<Vecteur> vtab(N);
@@ -90,17 +120,8 @@ int main()
         x[2] = genDouble();
         x[3] = genDouble();
     }
-    start = std::chrono::system_clock::now();
-    Bitonic::sort(true, vtab);
-    end = std::chrono::system_clock::now();
-    elapsed_seconds = end-start;
-    std::cout << "Temps calcul tri sur les vecteurs : " << elapsed_seconds.count() 
-              << std::endl;
-    for ( size_t i = 1; i < vtab.size(); ++i ) {
-        if ( vtab[i] < vtab[i-1] ) {
-            throw std::logic_error("Erreur de tri pour les vecteurs !");
-        }
-    }
+    benchSort("vecteurs", vtab);
+    benchKeySort(vtab);
     
     return 0;
 }
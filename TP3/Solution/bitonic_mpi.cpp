@@ -0,0 +1,285 @@
+// Tri distribué de réels : tri bitonique par fusion-partage entre les
+// processus, ou tri par échantillonnage
+# include <algorithm>
+# include <cmath>
+# include <cstdlib>
+# include <iostream>
+# include <limits>
+# include <random>
+# include <stdexcept>
+# include <string>
+# include <vector>
+# include <mpi.h>
+# include "Bitonic.hpp"
+
+MPI_Comm globComm;
+
+namespace {
+    const double sentinel = std::numeric_limits<double>::infinity();
+
+    // Tri local : tri bitonique à tâches (réseau SIMD en base), les données
+    // étant complétées par des sentinelles jusqu'à une puissance de deux
+    void localSort( std::vector<double>& x )
+    {
+        const std::size_t n = x.size();
+        std::size_t len = 1;
+        while ( len < n ) len *= 2;
+        x.resize(len, sentinel);
+        Bitonic::sort(true, x);
+        x.resize(n);
+    }
+
+    /** Redistribue une suite triée répartie dans l'ordre des rangs pour que
+     *  le processus r en ait les éléments [total*r/nbp, total*(r+1)/nbp) */
+    std::vector<double> rebalance( const std::vector<double>& local )
+    {
+        int nbp, rank;
+        MPI_Comm_size(globComm, &nbp);
+        MPI_Comm_rank(globComm, &rank);
+        long n = long(local.size());
+        std::vector<long> counts(nbp), offsets(nbp + 1, 0);
+        MPI_Allgather(&n, 1, MPI_LONG, counts.data(), 1, MPI_LONG, globComm);
+        for ( int q = 0; q < nbp; ++q ) offsets[q+1] = offsets[q] + counts[q];
+        const long total = offsets[nbp];
+        auto target = [total, nbp] ( int q ) { return total*q/nbp; };
+        // Intersection de mes éléments (ou de ceux de q) avec la cible de q
+        // (ou la mienne)
+        std::vector<int> sendCounts(nbp), sendDispls(nbp), recvCounts(nbp), recvDispls(nbp);
+        for ( int q = 0; q < nbp; ++q ) {
+            long first = std::max(offsets[rank], target(q)), last = std::min(offsets[rank+1], target(q+1));
+            sendCounts[q] = int(std::max(0L, last - first));
+            sendDispls[q] = int(std::max(0L, first - offsets[rank]));
+            first = std::max(offsets[q], target(rank));
+            last  = std::min(offsets[q+1], target(rank+1));
+            recvCounts[q] = int(std::max(0L, last - first));
+            recvDispls[q] = int(std::max(0L, first - target(rank)));
+        }
+        std::vector<double> balanced(target(rank+1) - target(rank));
+        MPI_Alltoallv(local.data(), sendCounts.data(), sendDispls.data(), MPI_DOUBLE,
+                      balanced.data(), recvCounts.data(), recvDispls.data(), MPI_DOUBLE, globComm);
+        return balanced;
+    }
+}
+
+/** Tri bitonique distribué : chaque processus trie son bloc, puis les
+ *  blocs (tous de la taille du plus grand, complétés par des sentinelles)
+ *  suivent le réseau de tri bitonique, chaque comparateur devenant une
+ *  fusion-partage entre deux processus : ils échangent leurs blocs et
+ *  gardent l'un la moitié basse, l'autre la moitié haute de leur fusion.
+ *
+ *  Le réseau est celui de Batcher pour un nombre quelconque de blocs
+ *  (forme de H. W. Lang) : pour fusionner n blocs, les blocs i < n - m sont
+ *  comparés aux blocs i + m, m étant la plus grande puissance de deux < n.
+ *  Pour nbp = 2^d, le partenaire à distance m est rank ^ m : les dimensions
+ *  de l'hypercube, parcourues comme dans TP1/Solution/Hypercube.cpp. Chaque
+ *  processus ne suit que les branches de la récursion qui le contiennent ;
+ *  tous rencontrent leurs comparateurs dans l'ordre d'un même parcours du
+ *  réseau, d'où l'absence d'interblocage.
+ **/
+class BitonicMergeSplit
+{
+public:
+    BitonicMergeSplit( std::vector<double>& block ) :
+        m_block(block), m_other(block.size()), m_merged(block.size()), m_rank(0)
+    {
+        MPI_Comm_rank(globComm, &m_rank);
+    }
+
+    /** Trie (up : croissant) les blocs des processus [lo, lo + n) */
+    void sort( int lo, int n, bool up )
+    {
+        if ( n <= 1 ) return;
+        int half = n/2;
+        if ( m_rank < lo + half ) sort(lo, half, !up);
+        else                      sort(lo + half, n - half, up);
+        merge(lo, n, up);
+    }
+private:
+    void merge( int lo, int n, bool up )
+    {
+        if ( n <= 1 ) return;
+        int m = 1;
+        while ( 2*m < n ) m *= 2;
+        if ( m_rank < lo + n - m )               mergeSplit(m_rank + m, up);
+        else if ( m_rank >= lo + m )             mergeSplit(m_rank - m, !up);
+        if ( m_rank < lo + m ) merge(lo, m, up);
+        else                   merge(lo + m, n - m, up);
+    }
+
+    void mergeSplit( int partner, bool keepLow )
+    {
+        const int len = int(m_block.size());
+        if ( len == 0 ) return;
+        // Blocs déjà dans l'ordre : rien à échanger
+        double mine = ( keepLow ? m_block.back() : m_block.front() ), theirs;
+        MPI_Sendrecv(&mine, 1, MPI_DOUBLE, partner, 0, &theirs, 1, MPI_DOUBLE, partner, 0,
+                     globComm, MPI_STATUS_IGNORE);
+        if ( keepLow ? (mine <= theirs) : (mine >= theirs) ) return;
+        MPI_Sendrecv(m_block.data(), len, MPI_DOUBLE, partner, 1, m_other.data(), len, MPI_DOUBLE, partner, 1,
+                     globComm, MPI_STATUS_IGNORE);
+        if ( keepLow ) {
+            for ( int k = 0, i = 0, j = 0; k < len; ++k )
+                m_merged[k] = ( m_other[j] < m_block[i] ? m_other[j++] : m_block[i++] );
+        } else {
+            for ( int k = len-1, i = len-1, j = len-1; k >= 0; --k )
+                m_merged[k] = ( m_other[j] > m_block[i] ? m_other[j--] : m_block[i--] );
+        }
+        m_block.swap(m_merged);
+    }
+
+    std::vector<double>& m_block;
+    std::vector<double> m_other, m_merged;
+    int m_rank;
+};
+
+std::vector<double>
+bitonicSortDistributed( std::vector<double> local )
+{
+    int nbp, rank;
+    MPI_Comm_size(globComm, &nbp);
+    MPI_Comm_rank(globComm, &rank);
+    long n = long(local.size()), len, total;
+    MPI_Allreduce(&n, &len, 1, MPI_LONG, MPI_MAX, globComm);
+    MPI_Allreduce(&n, &total, 1, MPI_LONG, MPI_SUM, globComm);
+    localSort(local);
+    local.resize(len, sentinel);
+    BitonicMergeSplit network(local);
+    network.sort(0, nbp, true);
+    // Les sentinelles terminent la suite : seuls les total premiers restent
+    local.resize(std::min(len, std::max(0L, total - rank*len)));
+    return rebalance(local);
+}
+
+/** Tri par échantillonnage (PSRS) : chaque processus trie son bloc et en
+ *  tire nbp échantillons réguliers ; les nbp - 1 séparateurs, pris
+ *  régulièrement dans les échantillons triés, découpent les blocs en
+ *  paquets envoyés à leur processus (MPI_Alltoallv), qui fusionne ses nbp
+ *  suites triées. Le coût ne dépend pas du plus grand bloc, contrairement
+ *  au tri bitonique : c'est l'alternative pour des données mal réparties.
+ **/
+std::vector<double>
+sampleSortDistributed( std::vector<double> local )
+{
+    int nbp;
+    MPI_Comm_size(globComm, &nbp);
+    localSort(local);
+    const std::size_t n = local.size();
+    std::vector<double> samples(nbp, sentinel), allSamples(std::size_t(nbp)*nbp);
+    for ( std::size_t k = 0; (k < std::size_t(nbp)) && (n > 0); ++k ) samples[k] = local[k*n/nbp];
+    MPI_Allgather(samples.data(), nbp, MPI_DOUBLE, allSamples.data(), nbp, MPI_DOUBLE, globComm);
+    std::sort(allSamples.begin(), allSamples.end());
+
+    std::vector<int> sendCounts(nbp), sendDispls(nbp), recvCounts(nbp), recvDispls(nbp);
+    std::size_t first = 0;
+    for ( int q = 0; q < nbp; ++q ) {
+        std::size_t last = n;
+        if ( q < nbp - 1 ) {
+            double splitter = allSamples[std::size_t(q+1)*nbp];
+            last = std::size_t(std::upper_bound(local.begin() + first, local.end(), splitter) - local.begin());
+        }
+        sendDispls[q] = int(first);
+        sendCounts[q] = int(last - first);
+        first = last;
+    }
+    MPI_Alltoall(sendCounts.data(), 1, MPI_INT, recvCounts.data(), 1, MPI_INT, globComm);
+    int nbRecv = 0;
+    for ( int q = 0; q < nbp; ++q ) { recvDispls[q] = nbRecv; nbRecv += recvCounts[q]; }
+    std::vector<double> bucket(nbRecv);
+    MPI_Alltoallv(local.data(), sendCounts.data(), sendDispls.data(), MPI_DOUBLE,
+                  bucket.data(), recvCounts.data(), recvDispls.data(), MPI_DOUBLE, globComm);
+    // Fusion des nbp suites reçues, deux à deux
+    std::vector<int> bounds(recvDispls);
+    bounds.push_back(nbRecv);
+    for ( std::size_t step = 1; step < std::size_t(nbp); step *= 2 )
+        for ( std::size_t q = 0; q + step < std::size_t(nbp); q += 2*step )
+            std::inplace_merge(bucket.begin() + bounds[q], bucket.begin() + bounds[q + step],
+                               bucket.begin() + bounds[std::min(q + 2*step, std::size_t(nbp))]);
+    return rebalance(bucket);
+}
+
+namespace {
+    // Vérifie que sorted, réparti sur les processus, est la suite triée et
+    // équilibrée des données de départ (nombre et somme, exacte sur des
+    // entiers)
+    void check( const std::string& name, const std::vector<double>& data, const std::vector<double>& sorted )
+    {
+        int nbp, rank;
+        MPI_Comm_size(globComm, &nbp);
+        MPI_Comm_rank(globComm, &rank);
+        double local[4] = { double(data.size()), 0., double(sorted.size()), 0. }, global[4];
+        for ( double x : data )   local[1] += x;
+        for ( double x : sorted ) local[3] += x;
+        MPI_Allreduce(local, global, 4, MPI_DOUBLE, MPI_SUM, globComm);
+        const long total = long(global[0]);
+        int ok = ( (global[0] == global[2]) && (global[1] == global[3]) &&
+                   (long(sorted.size()) == total*(rank+1)/nbp - total*rank/nbp) &&
+                   std::is_sorted(sorted.begin(), sorted.end()) );
+        // Mon premier élément ne doit pas précéder le dernier du précédent
+        double last = ( sorted.empty() ? -sentinel : sorted.back() ), previous = -sentinel;
+        MPI_Sendrecv(&last, 1, MPI_DOUBLE, ( rank + 1 < nbp ? rank + 1 : MPI_PROC_NULL ), 2,
+                     &previous, 1, MPI_DOUBLE, ( rank > 0 ? rank - 1 : MPI_PROC_NULL ), 2,
+                     globComm, MPI_STATUS_IGNORE);
+        if ( !sorted.empty() && (sorted.front() < previous) ) ok = 0;
+        int allOk;
+        MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_MIN, globComm);
+        if ( !allOk ) throw std::logic_error("Erreur du tri distribué " + name + " !");
+    }
+}
+
+int main( int nargs, char* argv[] )
+{
+    // Seul le thread principal fait des appels MPI, les tris locaux
+    // utilisent les tâches OpenMP
+    int provided;
+    MPI_Init_thread(&nargs, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_dup(MPI_COMM_WORLD, &globComm);
+    int nbp, rank;
+    MPI_Comm_size(globComm, &nbp);
+    MPI_Comm_rank(globComm, &rank);
+    // Arguments : log2 du nombre d'éléments (21 par défaut), au total
+    // (extensibilité forte) ou par processus avec "--weak" (extensibilité
+    // faible) ; "--skewed" : processus r chargé proportionnellement à r+1 et
+    // valeurs très concentrées (log-normales, beaucoup de doublons) ;
+    // "--seed s".
+    int log2N = 21;
+    bool weak = false, skewed = false;
+    unsigned seed = 1234;
+    for ( int i = 1; i < nargs; ++i ) {
+        std::string arg(argv[i]);
+        if ( arg == "--weak" ) weak = true;
+        else if ( arg == "--skewed" ) skewed = true;
+        else if ( (arg == "--seed") && (i+1 < nargs) ) seed = unsigned(std::stoul(argv[++i]));
+        else log2N = std::stoi(arg);
+    }
+    const long total = ( weak ? long(nbp) : 1L ) << log2N;
+    // Processus r : éléments [start(r), start(r+1)), de poids 1 ou r+1
+    auto start = [=] ( long r ) {
+        return ( skewed ? total*(r*(r+1)/2)/(long(nbp)*(nbp+1)/2) : total*r/nbp );
+    };
+    std::vector<double> data(start(rank+1) - start(rank));
+    std::mt19937 generator(seed + unsigned(rank));
+    std::uniform_int_distribution<int> intDistrib(-163845,163845);
+    std::lognormal_distribution<double> skewDistrib(0., 2.);
+    for ( auto& x : data )
+        x = ( skewed ? std::min(std::floor(skewDistrib(generator)), 1.E6) : double(intDistrib(generator)) );
+
+    typedef std::vector<double> (*DistributedSort)( std::vector<double> );
+    const DistributedSort sorts[2] = { bitonicSortDistributed, sampleSortDistributed };
+    const std::string names[2] = { "bitonique", "par échantillonnage" };
+    double times[2];
+    for ( int s = 0; s < 2; ++s ) {
+        MPI_Barrier(globComm);
+        double t0 = MPI_Wtime();
+        std::vector<double> sorted = sorts[s](data);
+        double elapsed = MPI_Wtime() - t0;
+        MPI_Reduce(&elapsed, &times[s], 1, MPI_DOUBLE, MPI_MAX, 0, globComm);
+        check(names[s], data, sorted);
+    }
+    if ( rank == 0 )
+        std::cout << nbp << " processus, " << total << " éléments (extensibilité "
+                  << ( weak ? "faible" : "forte" ) << ( skewed ? ", données déséquilibrées" : "" )
+                  << ") : tri bitonique " << times[0] << " s, tri par échantillonnage " << times[1]
+                  << " s" << std::endl;
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}